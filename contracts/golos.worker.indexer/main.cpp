@@ -0,0 +1,75 @@
+#include "worker_index.hpp"
+
+#include <fc/io/json.hpp>
+#include <fc/time.hpp>
+
+#include <iostream>
+
+using namespace golos::indexer;
+
+static void print(const proposal_row &proposal) {
+    std::cout << proposal.id << " " << proposal.author.to_string() << " state: " << int(proposal.state)
+              << " worker: " << proposal.worker.to_string() << " deposit: " << proposal.deposit.to_string()
+              << " \"" << proposal.title << "\"" << std::endl;
+}
+
+template <typename Range>
+static void print(const Range &range, fc::microseconds elapsed) {
+    size_t count = 0;
+    for (auto ptr = range.first; ptr != range.second; ++ptr, ++count) {
+        print(*ptr);
+    }
+    std::cout << count << " proposals, " << elapsed.count() << " us" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5 && argc != 7) {
+        std::cerr << "usage: " << argv[0] << " <contract account> <pool> <abi file> <traces file> [state|author|worker|search <value>]" << std::endl;
+        return 1;
+    }
+
+    try {
+        const auto abi = fc::json::from_file(argv[3]).as<eosio::chain::abi_def>();
+        worker_index index(account_name(argv[1]), argv[2], abi);
+
+        auto start = fc::time_point::now();
+        const size_t traces_count = index.apply_file(argv[4]);
+        std::cout << traces_count << " traces applied, " << (fc::time_point::now() - start).count() << " us" << std::endl;
+
+        if (argc == 5) {
+            start = fc::time_point::now();
+            print(std::make_pair(index.proposals().begin(), index.proposals().end()), fc::time_point::now() - start);
+            return 0;
+        }
+
+        const std::string key = argv[5];
+        const std::string value = argv[6];
+
+        start = fc::time_point::now();
+        if (key == "state") {
+            auto range = index.proposals_by_state(std::stoi(value));
+            print(range, fc::time_point::now() - start);
+        } else if (key == "author") {
+            auto range = index.proposals_by_author(account_name(value));
+            print(range, fc::time_point::now() - start);
+        } else if (key == "worker") {
+            auto range = index.proposals_by_worker(account_name(value));
+            print(range, fc::time_point::now() - start);
+        } else if (key == "search") {
+            auto matches = index.search(value, 20);
+            const auto elapsed = fc::time_point::now() - start;
+            static const char *kinds[] = {"title", "description", "tspec", "comment", "tspec comment", "status comment", "review comment"};
+            for (const auto &match : matches) {
+                std::cout << kinds[match.kind] << " " << match.id << " score: " << match.score << std::endl;
+            }
+            std::cout << matches.size() << " matches, " << elapsed.count() << " us" << std::endl;
+        } else {
+            std::cerr << "unknown query: " << key << std::endl;
+            return 1;
+        }
+    } catch (const fc::exception &e) {
+        std::cerr << e.to_detail_string() << std::endl;
+        return 1;
+    }
+    return 0;
+}
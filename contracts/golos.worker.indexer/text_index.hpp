@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Incremental full-text index of the proposal titles and descriptions, tspec texts and the comments of all the tables.
+// A document is indexed under a dense number, an edit or a removal only marks the old number as dead,
+// the dead postings are skipped by the queries and dropped by compact() once they outnumber the live ones.
+// Queries rank the documents containing any of the query terms with BM25 and return the top k.
+namespace golos {
+namespace indexer {
+
+enum text_kind_t : uint8_t {
+    TEXT_TITLE,
+    TEXT_DESCRIPTION,
+    TEXT_TSPEC,
+    TEXT_COMMENT,
+    TEXT_TSPEC_COMMENT,
+    TEXT_STATUS_COMMENT,
+    TEXT_REVIEW_COMMENT
+};
+
+constexpr uint32_t dead_document = UINT32_MAX;
+
+struct text_match_t {
+    text_kind_t kind;
+    uint64_t id;
+    double score;
+};
+
+class text_index {
+public:
+    // splits on everything but letters and digits, ASCII and Cyrillic are lowercased,
+    // the other non-ASCII UTF-8 characters are kept as they are
+    template <typename Visitor>
+    static void tokenize(const std::string &text, Visitor &&visitor) {
+        std::string term;
+        for (size_t i = 0; i < text.size(); i++) {
+            const unsigned char byte = static_cast<unsigned char>(text[i]);
+            const unsigned char next = i + 1 < text.size() ? static_cast<unsigned char>(text[i + 1]) : 0;
+            if ((byte >= 'a' && byte <= 'z') || (byte >= '0' && byte <= '9')) {
+                term.push_back(byte);
+            } else if (byte >= 'A' && byte <= 'Z') {
+                term.push_back(byte - 'A' + 'a');
+            } else if (byte == 0xD0 && next >= 0x90 && next <= 0x9F) { // А-П
+                term.push_back(0xD0);
+                term.push_back(next + 0x20);
+                i++;
+            } else if (byte == 0xD0 && next >= 0xA0 && next <= 0xAF) { // Р-Я
+                term.push_back(0xD1);
+                term.push_back(next - 0x20);
+                i++;
+            } else if (byte == 0xD0 && next == 0x81) { // Ё
+                term.push_back(0xD1);
+                term.push_back(0x91);
+                i++;
+            } else if (byte >= 0x80) {
+                term.push_back(byte);
+            } else if (!term.empty()) {
+                visitor(term);
+                term.clear();
+            }
+        }
+        if (!term.empty()) {
+            visitor(term);
+        }
+    }
+
+    // adds or replaces the document
+    void set(text_kind_t kind, uint64_t id, const std::string &text) {
+        remove(kind, id);
+
+        std::unordered_map<std::string, uint32_t> frequencies;
+        uint32_t length = 0;
+        tokenize(text, [&](const std::string &term) {
+            frequencies[term]++;
+            length++;
+        });
+
+        const uint32_t number = static_cast<uint32_t>(_documents.size());
+        _documents.push_back(document_t{kind, id, length, true});
+        _numbers[key(kind, id)] = number;
+        _live_count++;
+        _total_length += length;
+
+        for (const auto &frequency : frequencies) {
+            _postings[frequency.first].push_back(posting_t{number, frequency.second});
+        }
+    }
+
+    void remove(text_kind_t kind, uint64_t id) {
+        auto ptr = _numbers.find(key(kind, id));
+        if (ptr == _numbers.end()) {
+            return;
+        }
+
+        document_t &document = _documents[ptr->second];
+        document.alive = false;
+        _live_count--;
+        _total_length -= document.length;
+        _numbers.erase(ptr);
+
+        if (_documents.size() > 2 * _live_count + compact_threshold) {
+            compact();
+        }
+    }
+
+    bool contains(text_kind_t kind, uint64_t id) const {
+        return _numbers.count(key(kind, id)) != 0;
+    }
+
+    size_t size() const { return _live_count; }
+
+    std::vector<text_match_t> search(const std::string &query, size_t k) const {
+        std::vector<std::string> terms;
+        tokenize(query, [&](const std::string &term) {
+            if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+                terms.push_back(term);
+            }
+        });
+
+        // dense accumulator, the scored documents are listed in the touched
+        std::vector<float> scores(_documents.size(), 0);
+        std::vector<uint32_t> touched;
+        const double average_length = _live_count ? double(_total_length) / _live_count : 0;
+        for (const auto &term : terms) {
+            auto postings_ptr = _postings.find(term);
+            if (postings_ptr == _postings.end()) {
+                continue;
+            }
+
+            // the dead postings are counted too, it slightly lowers the weight of the frequently edited terms
+            const double frequency = postings_ptr->second.size();
+            const double idf = std::log(1 + (_live_count - std::min<double>(frequency, _live_count) + 0.5) / (frequency + 0.5));
+
+            for (const auto &posting : postings_ptr->second) {
+                const document_t &document = _documents[posting.document];
+                if (!document.alive) {
+                    continue;
+                }
+                const double tf = posting.frequency;
+                const double norm = k1 * (1 - b + b * document.length / (average_length > 0 ? average_length : 1));
+                float &score = scores[posting.document];
+                if (score == 0) {
+                    touched.push_back(posting.document);
+                }
+                score += idf * tf * (k1 + 1) / (tf + norm);
+            }
+        }
+
+        // min-heap of the best k
+        auto worse = [](const std::pair<float, uint32_t> &l, const std::pair<float, uint32_t> &r) {
+            return l.first > r.first || (l.first == r.first && l.second < r.second);
+        };
+        std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>, decltype(worse)> top(worse);
+        for (uint32_t document : touched) {
+            if (top.size() < k) {
+                top.emplace(scores[document], document);
+            } else if (k > 0 && worse(std::make_pair(scores[document], document), top.top())) {
+                top.pop();
+                top.emplace(scores[document], document);
+            }
+        }
+
+        std::vector<text_match_t> matches(top.size());
+        for (size_t i = matches.size(); i-- > 0; top.pop()) {
+            const document_t &document = _documents[top.top().second];
+            matches[i] = text_match_t{document.kind, document.id, top.top().first};
+        }
+        return matches;
+    }
+
+    // renumbers the live documents and drops the dead postings
+    void compact() {
+        std::vector<uint32_t> numbers(_documents.size(), dead_document);
+        std::vector<document_t> documents;
+        documents.reserve(_live_count);
+        for (uint32_t i = 0; i < _documents.size(); i++) {
+            if (_documents[i].alive) {
+                numbers[i] = static_cast<uint32_t>(documents.size());
+                documents.push_back(_documents[i]);
+            }
+        }
+
+        for (auto ptr = _postings.begin(); ptr != _postings.end(); ) {
+            auto &postings = ptr->second;
+            postings.erase(std::remove_if(postings.begin(), postings.end(), [&](posting_t &posting) {
+                posting.document = numbers[posting.document];
+                return posting.document == dead_document;
+            }), postings.end());
+            ptr = postings.empty() ? _postings.erase(ptr) : std::next(ptr);
+        }
+
+        for (auto &number : _numbers) {
+            number.second = numbers[number.second];
+        }
+        _documents = std::move(documents);
+    }
+
+private:
+    static constexpr double k1 = 1.2;
+    static constexpr double b = 0.75;
+    static constexpr size_t compact_threshold = 1024;
+
+    struct document_t {
+        text_kind_t kind;
+        uint64_t id;
+        uint32_t length;
+        bool alive;
+    };
+
+    struct posting_t {
+        uint32_t document;
+        uint32_t frequency;
+    };
+
+    static std::pair<uint8_t, uint64_t> key(text_kind_t kind, uint64_t id) { return {kind, id}; }
+
+    std::vector<document_t> _documents;
+    std::map<std::pair<uint8_t, uint64_t>, uint32_t> _numbers;
+    std::unordered_map<std::string, std::vector<posting_t>> _postings;
+    size_t _live_count = 0;
+    uint64_t _total_length = 0;
+};
+
+} // namespace indexer
+} // namespace golos
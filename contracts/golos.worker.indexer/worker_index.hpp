@@ -0,0 +1,620 @@
+#pragma once
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/block_timestamp.hpp>
+#include <eosio/chain/trace.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "../golos.worker/proposal_rules.hpp"
+#include "text_index.hpp"
+
+// In-memory index of the golos.worker state rebuilt from the action traces of the contract.
+// Action data is decoded with the contract ABI, which is generated from the EOSLIB_SERIALIZE
+// definitions of golos.worker.cpp, so the decoding follows the contract without duplicating its structs.
+//
+// The input is a feed of action traces, not the state-history: one eosio::chain::action_trace per line
+// in its fc::json form, of which receipt.receiver, act, block_time and inline_traces are read. The feed
+// holds the traces of the applied transactions only, in the execution order and without gaps, starting
+// from the deployment of the contract or from the import of its rows. The indexer doesn't follow forks,
+// the feed is expected to end at the last irreversible block.
+namespace golos {
+namespace indexer {
+
+using eosio::chain::account_name;
+using eosio::chain::action;
+using eosio::chain::action_trace;
+using eosio::chain::asset;
+using eosio::chain::block_timestamp_type;
+namespace bmi = boost::multi_index;
+
+struct proposal_row {
+    uint64_t id = 0;
+    account_name author;
+    uint8_t type = 0;
+    uint8_t state = 0;
+    std::string title;
+    account_name worker;
+    uint64_t tspec_id = 0;
+    asset deposit;
+    block_timestamp_type created;
+    block_timestamp_type modified;
+};
+
+struct tspec_row {
+    uint64_t id = 0;
+    uint64_t proposal_id = 0;
+    account_name author;
+    asset specification_cost;
+    uint32_t specification_eta = 0;
+    asset development_cost;
+    uint32_t development_eta = 0;
+    uint16_t payments_count = 0;
+    uint32_t payments_interval = 0;
+    block_timestamp_type created;
+    block_timestamp_type modified;
+};
+
+struct vote_row {
+    account_name table;
+    uint64_t foreign_id = 0;
+    account_name voter;
+    bool positive = false;
+};
+
+// the comments of all the tables, the foreign ID refers to a tspec for the tspecappc comments and to a proposal for the others
+struct comment_row {
+    account_name table;
+    uint64_t id = 0;
+    uint64_t foreign_id = 0;
+    account_name author;
+    block_timestamp_type created;
+    block_timestamp_type modified;
+};
+
+struct by_id;
+struct by_state;
+struct by_author;
+struct by_worker;
+struct by_created;
+struct by_proposal;
+struct by_target;
+struct by_voter;
+
+using proposal_index = bmi::multi_index_container<proposal_row, bmi::indexed_by<
+    bmi::ordered_unique<bmi::tag<by_id>, bmi::member<proposal_row, uint64_t, &proposal_row::id>>,
+    bmi::ordered_non_unique<bmi::tag<by_state>, bmi::composite_key<proposal_row,
+        bmi::member<proposal_row, uint8_t, &proposal_row::state>,
+        bmi::member<proposal_row, block_timestamp_type, &proposal_row::created>>>,
+    bmi::ordered_non_unique<bmi::tag<by_author>, bmi::composite_key<proposal_row,
+        bmi::member<proposal_row, account_name, &proposal_row::author>,
+        bmi::member<proposal_row, block_timestamp_type, &proposal_row::created>>>,
+    bmi::ordered_non_unique<bmi::tag<by_worker>, bmi::composite_key<proposal_row,
+        bmi::member<proposal_row, account_name, &proposal_row::worker>,
+        bmi::member<proposal_row, block_timestamp_type, &proposal_row::created>>>,
+    bmi::ordered_non_unique<bmi::tag<by_created>, bmi::member<proposal_row, block_timestamp_type, &proposal_row::created>>
+>>;
+
+using tspec_index = bmi::multi_index_container<tspec_row, bmi::indexed_by<
+    bmi::ordered_unique<bmi::tag<by_id>, bmi::member<tspec_row, uint64_t, &tspec_row::id>>,
+    bmi::ordered_non_unique<bmi::tag<by_proposal>, bmi::member<tspec_row, uint64_t, &tspec_row::proposal_id>>,
+    bmi::ordered_non_unique<bmi::tag<by_author>, bmi::composite_key<tspec_row,
+        bmi::member<tspec_row, account_name, &tspec_row::author>,
+        bmi::member<tspec_row, block_timestamp_type, &tspec_row::created>>>
+>>;
+
+using vote_index = bmi::multi_index_container<vote_row, bmi::indexed_by<
+    bmi::ordered_unique<bmi::tag<by_target>, bmi::composite_key<vote_row,
+        bmi::member<vote_row, account_name, &vote_row::table>,
+        bmi::member<vote_row, uint64_t, &vote_row::foreign_id>,
+        bmi::member<vote_row, account_name, &vote_row::voter>>>,
+    bmi::ordered_non_unique<bmi::tag<by_voter>, bmi::member<vote_row, account_name, &vote_row::voter>>
+>>;
+
+using comment_index = bmi::multi_index_container<comment_row, bmi::indexed_by<
+    bmi::ordered_unique<bmi::tag<by_id>, bmi::composite_key<comment_row,
+        bmi::member<comment_row, account_name, &comment_row::table>,
+        bmi::member<comment_row, uint64_t, &comment_row::id>>>,
+    bmi::ordered_non_unique<bmi::tag<by_target>, bmi::composite_key<comment_row,
+        bmi::member<comment_row, account_name, &comment_row::table>,
+        bmi::member<comment_row, uint64_t, &comment_row::foreign_id>,
+        bmi::member<comment_row, block_timestamp_type, &comment_row::created>>>,
+    bmi::ordered_non_unique<bmi::tag<by_author>, bmi::member<comment_row, account_name, &comment_row::author>>
+>>;
+
+template <typename Index>
+using range_t = std::pair<typename Index::const_iterator, typename Index::const_iterator>;
+
+class worker_index {
+public:
+    // indexes one pool of the contract, `pool` is its token symbol code
+    worker_index(account_name contract, const std::string &pool, const eosio::chain::abi_def &abi, fc::microseconds max_time = fc::seconds(1))
+        : _contract(contract), _pool(pool), _abi(abi, max_time), _max_time(max_time) {}
+
+    // applies the action and its inline actions (the events) in the execution order
+    void apply(const action_trace &trace) {
+        if (trace.receipt.receiver == _contract && trace.act.account == _contract) {
+            apply(trace.act, trace.block_time);
+        }
+        for (const auto &inline_trace : trace.inline_traces) {
+            apply(inline_trace);
+        }
+    }
+
+    // reads a feed of action traces, one JSON object per line
+    size_t apply_file(const std::string &path) {
+        std::ifstream feed(path);
+        FC_ASSERT(feed, "can't open the traces feed ${path}", ("path", path));
+
+        size_t count = 0;
+        std::string line;
+        while (std::getline(feed, line)) {
+            if (!line.empty()) {
+                apply(fc::json::from_string(line).as<action_trace>());
+                count++;
+            }
+        }
+        return count;
+    }
+
+    const proposal_row *find_proposal(uint64_t id) const {
+        auto ptr = _proposals.find(id);
+        return ptr != _proposals.end() ? &*ptr : nullptr;
+    }
+
+    range_t<proposal_index::index<by_state>::type> proposals_by_state(uint8_t state) const {
+        return _proposals.get<by_state>().equal_range(std::make_tuple(state));
+    }
+
+    range_t<proposal_index::index<by_author>::type> proposals_by_author(account_name author) const {
+        return _proposals.get<by_author>().equal_range(std::make_tuple(author));
+    }
+
+    range_t<proposal_index::index<by_worker>::type> proposals_by_worker(account_name worker) const {
+        return _proposals.get<by_worker>().equal_range(std::make_tuple(worker));
+    }
+
+    range_t<proposal_index::index<by_created>::type> proposals_created(block_timestamp_type from, block_timestamp_type to) const {
+        const auto &index = _proposals.get<by_created>();
+        return {index.lower_bound(from), index.upper_bound(to)};
+    }
+
+    const tspec_row *find_tspec(uint64_t id) const {
+        auto ptr = _tspecs.find(id);
+        return ptr != _tspecs.end() ? &*ptr : nullptr;
+    }
+
+    range_t<tspec_index::index<by_proposal>::type> tspecs_by_proposal(uint64_t proposal_id) const {
+        return _tspecs.get<by_proposal>().equal_range(proposal_id);
+    }
+
+    range_t<vote_index::index<by_target>::type> votes(account_name table, uint64_t foreign_id) const {
+        return _votes.get<by_target>().equal_range(std::make_tuple(table, foreign_id));
+    }
+
+    range_t<vote_index::index<by_voter>::type> votes_by_voter(account_name voter) const {
+        return _votes.get<by_voter>().equal_range(voter);
+    }
+
+    range_t<comment_index::index<by_target>::type> comments(account_name table, uint64_t foreign_id) const {
+        return _comments.get<by_target>().equal_range(std::make_tuple(table, foreign_id));
+    }
+
+    range_t<comment_index::index<by_author>::type> comments_by_author(account_name author) const {
+        return _comments.get<by_author>().equal_range(author);
+    }
+
+    fc::optional<asset> fund(account_name fund_name) const {
+        auto ptr = _funds.find(fund_name);
+        return ptr != _funds.end() ? fc::optional<asset>(ptr->second) : fc::optional<asset>();
+    }
+
+    // the top k titles, descriptions, tspecs and comments matching any of the query words
+    std::vector<text_match_t> search(const std::string &query, size_t k) const {
+        return _texts.search(query, k);
+    }
+
+    const text_index &texts() const { return _texts; }
+    const proposal_index &proposals() const { return _proposals; }
+    const tspec_index &tspecs() const { return _tspecs; }
+    const vote_index &all_votes() const { return _votes; }
+    const comment_index &comments() const { return _comments; }
+
+private:
+    template <typename Index, typename Key, typename Modifier>
+    static void modify(Index &index, const Key &key, Modifier &&modifier) {
+        auto ptr = index.find(key);
+        if (ptr != index.end()) {
+            index.modify(ptr, modifier);
+        }
+    }
+
+    template <typename Index, typename Range>
+    static void erase(Index &index, const Range &range) {
+        index.erase(range.first, range.second);
+    }
+
+    static text_kind_t comment_kind(account_name table) {
+        if (table == N(tspecappc)) return TEXT_TSPEC_COMMENT;
+        if (table == N(statusc)) return TEXT_STATUS_COMMENT;
+        if (table == N(reviewc)) return TEXT_REVIEW_COMMENT;
+        return TEXT_COMMENT;
+    }
+
+    // a comment posted again under the same ID replaces the text
+    void set_comment(account_name table, uint64_t id, uint64_t foreign_id, account_name author, const std::string &text, block_timestamp_type time) {
+        comment_row comment;
+        comment.table = table;
+        comment.id = id;
+        comment.foreign_id = foreign_id;
+        comment.author = author;
+        comment.created = time;
+        auto ptr = _comments.find(std::make_tuple(table, id));
+        if (ptr != _comments.end()) {
+            comment.created = ptr->created;
+            comment.modified = time;
+            _comments.replace(ptr, comment);
+        } else {
+            _comments.insert(comment);
+        }
+        _texts.set(comment_kind(table), id, text);
+    }
+
+    void erase_comments(account_name table, uint64_t foreign_id) {
+        auto range = comments(table, foreign_id);
+        for (auto ptr = range.first; ptr != range.second; ++ptr) {
+            _texts.remove(comment_kind(table), ptr->id);
+        }
+        erase(_comments.get<by_target>(), range);
+    }
+
+    static tspec_row make_tspec(const fc::variant &data) {
+        tspec_row tspec;
+        tspec.specification_cost = data["specification_cost"].as<asset>();
+        tspec.specification_eta = data["specification_eta"].as<uint32_t>();
+        tspec.development_cost = data["development_cost"].as<asset>();
+        tspec.development_eta = data["development_eta"].as<uint32_t>();
+        tspec.payments_count = data["payments_count"].as<uint16_t>();
+        tspec.payments_interval = data["payments_interval"].as<uint32_t>();
+        return tspec;
+    }
+
+    void apply(const action &act, block_timestamp_type time) {
+        const std::string type = _abi.get_action_type(act.name);
+        if (type.empty()) {
+            return;
+        }
+        const fc::variant data = _abi.binary_to_variant(type, act.data, _max_time);
+        const std::string name = act.name.to_string();
+
+        // the actions recorded before the pools were scoped have no pool and belong to the only pool there was
+        const auto pool = data.get_object().find("pool");
+        if (pool != data.get_object().end() && pool->value().as_string() != _pool) {
+            return;
+        }
+
+        if (name == "addpropos" || name == "addpropos2") {
+            proposal_row proposal;
+            proposal.id = data["proposal_id"].as_uint64();
+            proposal.author = data["author"].as<account_name>();
+            proposal.title = data["title"].as_string();
+            proposal.created = time;
+            _texts.set(TEXT_TITLE, proposal.id, proposal.title);
+            _texts.set(TEXT_DESCRIPTION, proposal.id, data["description"].as_string());
+            if (name == "addpropos2") {
+                proposal.type = proposal_rules::TYPE_2;
+                proposal.worker = data["worker"].as<account_name>();
+                // the tspec ID is chosen by the contract, it comes with the following eventpropos
+                _pending_tspec = make_tspec(data["tspec"]);
+                _pending_tspec->proposal_id = proposal.id;
+                _pending_tspec->author = proposal.author;
+                _pending_tspec->created = time;
+                _pending_tspec_text = data["tspec"]["text"].as_string();
+            } else {
+                proposal.type = proposal_rules::TYPE_1;
+            }
+            _proposals.insert(proposal);
+            if (name == "addpropos2") {
+                set_comment(N(statusc), data["comment_id"].as_uint64(), proposal.id, proposal.author, data["comment"]["text"].as_string(), time);
+            }
+        }
+        else if (name == "editpropos") {
+            const uint64_t proposal_id = data["proposal_id"].as_uint64();
+            modify(_proposals, proposal_id, [&](proposal_row &proposal) {
+                if (!data["title"].is_null()) {
+                    proposal.title = data["title"].as_string();
+                    _texts.set(TEXT_TITLE, proposal_id, proposal.title);
+                }
+                proposal.modified = time;
+            });
+            if (!data["description"].is_null()) {
+                _texts.set(TEXT_DESCRIPTION, proposal_id, data["description"].as_string());
+            }
+        }
+        else if (name == "startwork") {
+            modify(_proposals, data["proposal_id"].as_uint64(), [&](proposal_row &proposal) {
+                proposal.worker = data["worker"].as<account_name>();
+            });
+        }
+        else if (name == "eventpropos") {
+            apply_proposal_event(data, time);
+        }
+        else if (name == "addtspec") {
+            tspec_row tspec = make_tspec(data["tspec"]);
+            tspec.id = data["tspec_app_id"].as_uint64();
+            tspec.proposal_id = data["proposal_id"].as_uint64();
+            tspec.author = data["author"].as<account_name>();
+            tspec.created = time;
+            _tspecs.insert(tspec);
+            _texts.set(TEXT_TSPEC, tspec.id, data["tspec"]["text"].as_string());
+        }
+        else if (name == "edittspec") {
+            const fc::variant &patch = data["patch"];
+            const uint64_t tspec_id = data["tspec_app_id"].as_uint64();
+            if (!patch["text"].is_null()) {
+                _texts.set(TEXT_TSPEC, tspec_id, patch["text"].as_string());
+            }
+            modify(_tspecs, tspec_id, [&](tspec_row &tspec) {
+                if (!patch["specification_cost"].is_null()) tspec.specification_cost = patch["specification_cost"].as<asset>();
+                if (!patch["specification_eta"].is_null()) tspec.specification_eta = patch["specification_eta"].as<uint32_t>();
+                if (!patch["development_cost"].is_null()) tspec.development_cost = patch["development_cost"].as<asset>();
+                if (!patch["development_eta"].is_null()) tspec.development_eta = patch["development_eta"].as<uint32_t>();
+                if (!patch["payments_count"].is_null()) tspec.payments_count = patch["payments_count"].as<uint16_t>();
+                if (!patch["payments_interval"].is_null()) tspec.payments_interval = patch["payments_interval"].as<uint32_t>();
+                tspec.modified = time;
+            });
+        }
+        else if (name == "deltspec") {
+            erase_tspec(data["tspec_app_id"].as_uint64());
+        }
+        else if (name == "addcomment") {
+            set_comment(N(proposalsc), data["comment_id"].as_uint64(), data["proposal_id"].as_uint64(),
+                        data["author"].as<account_name>(), data["data"]["text"].as_string(), time);
+        }
+        else if (name == "editcomment") {
+            const uint64_t comment_id = data["comment_id"].as_uint64();
+            modify(_comments, std::make_tuple(N(proposalsc), comment_id), [&](comment_row &comment) {
+                comment.modified = time;
+            });
+            _texts.set(TEXT_COMMENT, comment_id, data["data"]["text"].as_string());
+        }
+        else if (name == "delcomment") {
+            const uint64_t comment_id = data["comment_id"].as_uint64();
+            auto ptr = _comments.find(std::make_tuple(N(proposalsc), comment_id));
+            if (ptr != _comments.end()) {
+                _comments.erase(ptr);
+            }
+            _texts.remove(TEXT_COMMENT, comment_id);
+        }
+        else if (name == "approvetspec") {
+            // the contract stores the comment of an approval only when it has a text
+            const std::string text = data["comment"]["text"].as_string();
+            if (!text.empty()) {
+                set_comment(N(tspecappc), data["comment_id"].as_uint64(), data["tspec_app_id"].as_uint64(),
+                            data["author"].as<account_name>(), text, time);
+            }
+        }
+        else if (name == "poststatus" || name == "acceptwork") {
+            // the status is posted by the worker, the work is accepted by the author of the selected tspec
+            const uint64_t proposal_id = data["proposal_id"].as_uint64();
+            const auto *proposal = find_proposal(proposal_id);
+            const auto *tspec = proposal ? find_tspec(proposal->tspec_id) : nullptr;
+            const account_name author = name == "poststatus" ? (proposal ? proposal->worker : account_name())
+                                                             : (tspec ? tspec->author : account_name());
+            set_comment(N(statusc), data["comment_id"].as_uint64(), proposal_id, author, data["comment"]["text"].as_string(), time);
+        }
+        else if (name == "reviewwork") {
+            // the contract keeps no row for the comment of a review, it's indexed from the action the same way
+            const std::string text = data["comment"]["text"].as_string();
+            if (!text.empty()) {
+                set_comment(N(reviewc), data["comment_id"].as_uint64(), data["proposal_id"].as_uint64(),
+                            data["reviewer"].as<account_name>(), text, time);
+            }
+        }
+        else if (name == "eventvote") {
+            apply_vote_event(data);
+        }
+        else if (name == "eventfund") {
+            _funds[data["fund_name"].as<account_name>()] = data["quantity"].as<asset>();
+        }
+        else if (name == "import") {
+            apply_import(data);
+        }
+    }
+
+    // the imported rows send no events, they are taken from the action as they are. A batch sent again
+    // repeats the rows already inserted, the unique indexes keep the first copy
+    void apply_import(const fc::variant &data) {
+        std::map<std::string, std::string> texts;
+        for (const auto &text : data["texts"].get_array()) {
+            const std::string value = text.as_string();
+            texts[fc::sha256::hash(value).str()] = value;
+        }
+        // a row keeps its text inline or refers to the text store by the hash field, the texts stored
+        // before the batch aren't sent with it, they are left out of the search
+        auto set_text = [&](text_kind_t kind, uint64_t id, const std::string &text, const fc::variant &row, const char *hash_field) {
+            if (!text.empty()) {
+                _texts.set(kind, id, text);
+                return;
+            }
+            if (!row.get_object().contains(hash_field)) {
+                return;
+            }
+            auto ptr = texts.find(row[hash_field].as_string());
+            if (ptr != texts.end()) {
+                _texts.set(kind, id, ptr->second);
+            }
+        };
+
+        for (const auto &row : data["proposals"].get_array()) {
+            proposal_row proposal;
+            proposal.id = row["id"].as_uint64();
+            proposal.author = row["author"].as<account_name>();
+            proposal.type = row["type"].as<uint8_t>();
+            proposal.state = row["state"].as<uint8_t>();
+            proposal.title = row["title"].as_string();
+            proposal.worker = row["worker"].as<account_name>();
+            proposal.tspec_id = row["tspec_id"].as_uint64();
+            proposal.deposit = row["deposit"].as<asset>();
+            proposal.created = row["created"].as<block_timestamp_type>();
+            proposal.modified = row["modified"].as<block_timestamp_type>();
+            _proposals.insert(proposal);
+            _texts.set(TEXT_TITLE, proposal.id, proposal.title);
+            set_text(TEXT_DESCRIPTION, proposal.id, row["description"].as_string(), row, "description_hash");
+        }
+        for (const auto &row : data["tspecs"].get_array()) {
+            tspec_row tspec = make_tspec(row["data"]);
+            tspec.id = row["id"].as_uint64();
+            tspec.proposal_id = row["foreign_id"].as_uint64();
+            tspec.author = row["author"].as<account_name>();
+            tspec.created = row["created"].as<block_timestamp_type>();
+            tspec.modified = row["modified"].as<block_timestamp_type>();
+            _tspecs.insert(tspec);
+            set_text(TEXT_TSPEC, tspec.id, row["data"]["text"].as_string(), row, "text_hash");
+        }
+        // the hashed comments are searchable only if the batch brings their texts
+        auto import_comments = [&](const char *field, account_name table) {
+            for (const auto &row : data[field].get_array()) {
+                comment_row comment;
+                comment.table = table;
+                comment.id = row["id"].as_uint64();
+                comment.foreign_id = row["foreign_id"].as_uint64();
+                comment.author = row["author"].as<account_name>();
+                comment.created = row["created"].as<block_timestamp_type>();
+                comment.modified = row["modified"].as<block_timestamp_type>();
+                _comments.insert(comment);
+                set_text(comment_kind(table), comment.id, row["data"]["text"].as_string(), row, "text_hash");
+            }
+        };
+        auto import_votes = [&](const char *field, account_name table) {
+            for (const auto &row : data[field].get_array()) {
+                vote_row vote;
+                vote.table = table;
+                vote.foreign_id = row["foreign_id"].as_uint64();
+                vote.voter = row["voter"].as<account_name>();
+                vote.positive = row["positive"].as_bool();
+                _votes.insert(vote);
+            }
+        };
+        import_comments("comments", N(proposalsc));
+        import_votes("votes", N(proposalsv));
+        import_comments("tspec_comments", N(tspecappc));
+        import_comments("status_comments", N(statusc));
+        import_comments("review_comments", N(reviewc));
+        import_votes("tspec_votes", N(proposalstsv));
+        import_votes("review_votes", N(proposalsrv));
+    }
+
+    void apply_proposal_event(const fc::variant &data, block_timestamp_type time) {
+        const uint64_t proposal_id = data["proposal_id"].as_uint64();
+        const uint8_t state = data["state"].as<uint8_t>();
+
+        if (state == 0) {
+            // the proposal has been deleted along with its tspecs, comments and votes
+            const auto tspecs = _tspecs.get<by_proposal>().equal_range(proposal_id);
+            std::vector<uint64_t> tspec_ids;
+            for (auto ptr = tspecs.first; ptr != tspecs.second; ++ptr) {
+                tspec_ids.push_back(ptr->id);
+            }
+            for (uint64_t tspec_id : tspec_ids) {
+                erase_tspec(tspec_id);
+            }
+            erase_comments(N(proposalsc), proposal_id);
+            erase_comments(N(statusc), proposal_id);
+            erase_comments(N(reviewc), proposal_id);
+            _texts.remove(TEXT_TITLE, proposal_id);
+            _texts.remove(TEXT_DESCRIPTION, proposal_id);
+            erase(_votes.get<by_target>(), votes(N(proposalsv), proposal_id));
+            erase(_votes.get<by_target>(), votes(N(proposalsrv), proposal_id));
+            _proposals.erase(proposal_id);
+            return;
+        }
+
+        const uint64_t tspec_id = data["tspec_id"].as_uint64();
+        modify(_proposals, proposal_id, [&](proposal_row &proposal) {
+            proposal.state = state;
+            proposal.tspec_id = tspec_id;
+            proposal.deposit = data["deposit"].as<asset>();
+        });
+
+        if (state == proposal_rules::STATE_TSPEC_CREATE || state == proposal_rules::STATE_CLOSED) {
+            // the applications that lost the selection or expired are reclaimed by the contract
+            const auto tspecs = _tspecs.get<by_proposal>().equal_range(proposal_id);
+            std::vector<uint64_t> tspec_ids;
+            for (auto ptr = tspecs.first; ptr != tspecs.second; ++ptr) {
+                if (ptr->id != tspec_id) {
+                    tspec_ids.push_back(ptr->id);
+                }
+            }
+            for (uint64_t id : tspec_ids) {
+                erase_tspec(id);
+            }
+        }
+
+        if (_pending_tspec && _pending_tspec->proposal_id == proposal_id) {
+            _pending_tspec->id = tspec_id;
+            _tspecs.insert(*_pending_tspec);
+            _texts.set(TEXT_TSPEC, tspec_id, _pending_tspec_text);
+            _pending_tspec.reset();
+        }
+    }
+
+    void apply_vote_event(const fc::variant &data) {
+        vote_row vote;
+        vote.table = data["votes_table"].as<account_name>();
+        vote.foreign_id = data["foreign_id"].as_uint64();
+        vote.voter = data["voter"].as<account_name>();
+        const int8_t value = data["vote"].as<int8_t>();
+
+        auto &index = _votes.get<by_target>();
+        auto ptr = index.find(std::make_tuple(vote.table, vote.foreign_id, vote.voter));
+        if (value == 0) {
+            if (ptr != index.end()) {
+                index.erase(ptr);
+            }
+            return;
+        }
+
+        vote.positive = value > 0;
+        if (ptr != index.end()) {
+            index.replace(ptr, vote);
+        } else {
+            index.insert(vote);
+        }
+    }
+
+    void erase_tspec(uint64_t tspec_id) {
+        erase(_votes.get<by_target>(), votes(N(proposalstsv), tspec_id));
+        erase_comments(N(tspecappc), tspec_id);
+        _tspecs.erase(tspec_id);
+        _texts.remove(TEXT_TSPEC, tspec_id);
+    }
+
+    account_name _contract;
+    std::string _pool;
+    eosio::chain::abi_serializer _abi;
+    fc::microseconds _max_time;
+
+    proposal_index _proposals;
+    tspec_index _tspecs;
+    vote_index _votes;
+    comment_index _comments;
+    std::map<account_name, asset> _funds;
+    fc::optional<tspec_row> _pending_tspec;
+    std::string _pending_tspec_text;
+    text_index _texts;
+};
+
+} // namespace indexer
+} // namespace golos
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Columnar table file: a header, the column descriptors and the column data, every part aligned to 8 bytes,
+// so a reader maps the file and uses the fixed-width columns as plain arrays.
+// A text column is an array of rows + 1 offsets into its blob, the text of the row i is [offsets[i], offsets[i + 1]).
+namespace golos {
+namespace snapshot {
+
+enum column_type_t : uint8_t {
+    COLUMN_UINT8 = 1,
+    COLUMN_UINT16,
+    COLUMN_UINT32,
+    COLUMN_UINT64,
+    COLUMN_INT64,
+    COLUMN_BYTES32,
+    COLUMN_TEXT
+};
+
+constexpr uint64_t column_width(column_type_t type) {
+    return type == COLUMN_UINT8 ? 1 :
+           type == COLUMN_UINT16 ? 2 :
+           type == COLUMN_UINT32 ? 4 :
+           type == COLUMN_BYTES32 ? 32 : 8; // uint64, int64 and the offsets of text
+}
+
+constexpr char file_magic[8] = {'G', 'W', 'C', 'O', 'L', '1', 0, 0};
+constexpr size_t column_name_size = 48;
+
+struct file_header_t {
+    char magic[8];
+    uint64_t rows;
+    uint64_t columns;
+};
+
+struct column_header_t {
+    char name[column_name_size];
+    uint64_t type;
+    uint64_t offset;      // values, or the offsets of a text column
+    uint64_t size;
+    uint64_t blob_offset; // text column only
+    uint64_t blob_size;
+};
+
+constexpr uint64_t align8(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+class column_builder {
+public:
+    column_builder(std::string name, column_type_t type) : _name(std::move(name)), _type(type) {
+        if (_name.size() >= column_name_size) {
+            throw std::invalid_argument("column name is too long: " + _name);
+        }
+        if (_type == COLUMN_TEXT) {
+            push_value(uint64_t(0));
+        }
+    }
+
+    const std::string &name() const { return _name; }
+    column_type_t type() const { return _type; }
+
+    void push(uint64_t value) {
+        switch (_type) {
+        case COLUMN_UINT8: push_value(static_cast<uint8_t>(value)); break;
+        case COLUMN_UINT16: push_value(static_cast<uint16_t>(value)); break;
+        case COLUMN_UINT32: push_value(static_cast<uint32_t>(value)); break;
+        case COLUMN_UINT64: push_value(value); break;
+        case COLUMN_INT64: push_value(static_cast<int64_t>(value)); break;
+        default: throw std::logic_error("column " + _name + " isn't an integer column");
+        }
+    }
+
+    void push_bytes32(const char *data) {
+        if (_type != COLUMN_BYTES32) {
+            throw std::logic_error("column " + _name + " isn't a bytes32 column");
+        }
+        _data.insert(_data.end(), data, data + 32);
+    }
+
+    void push_text(const char *data, size_t size) {
+        if (_type != COLUMN_TEXT) {
+            throw std::logic_error("column " + _name + " isn't a text column");
+        }
+        _blob.insert(_blob.end(), data, data + size);
+        push_value(static_cast<uint64_t>(_blob.size()));
+    }
+
+    const std::vector<char> &data() const { return _data; }
+    const std::vector<char> &blob() const { return _blob; }
+
+private:
+    template <typename T>
+    void push_value(T value) {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        _data.insert(_data.end(), bytes, bytes + sizeof(T));
+    }
+
+    std::string _name;
+    column_type_t _type;
+    std::vector<char> _data;
+    std::vector<char> _blob;
+};
+
+class table_writer {
+public:
+    size_t add_column(const std::string &name, column_type_t type) {
+        _columns.emplace_back(name, type);
+        return _columns.size() - 1;
+    }
+
+    column_builder &column(size_t index) { return _columns.at(index); }
+    const std::vector<column_builder> &columns() const { return _columns; }
+
+    void end_row() { _rows++; }
+    uint64_t rows() const { return _rows; }
+
+    void write(const std::string &path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("can't open " + path);
+        }
+
+        file_header_t header{};
+        memcpy(header.magic, file_magic, sizeof(file_magic));
+        header.rows = _rows;
+        header.columns = _columns.size();
+
+        std::vector<column_header_t> column_headers(_columns.size());
+        uint64_t offset = sizeof(file_header_t) + sizeof(column_header_t) * _columns.size();
+        for (size_t i = 0; i < _columns.size(); i++) {
+            const auto &column = _columns[i];
+            auto &column_header = column_headers[i];
+            strncpy(column_header.name, column.name().c_str(), column_name_size - 1);
+            column_header.type = column.type();
+            column_header.offset = offset;
+            column_header.size = column.data().size();
+            offset += align8(column_header.size);
+            column_header.blob_offset = offset;
+            column_header.blob_size = column.blob().size();
+            offset += align8(column_header.blob_size);
+        }
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(column_headers.data()), sizeof(column_header_t) * column_headers.size());
+        for (const auto &column : _columns) {
+            write_aligned(file, column.data());
+            write_aligned(file, column.blob());
+        }
+    }
+
+private:
+    static void write_aligned(std::ofstream &file, const std::vector<char> &data) {
+        static const char padding[8] = {};
+        file.write(data.data(), data.size());
+        file.write(padding, align8(data.size()) - data.size());
+    }
+
+    std::vector<column_builder> _columns;
+    uint64_t _rows = 0;
+};
+
+// maps a columnar table file, the values are read in place
+class table_reader {
+public:
+    explicit table_reader(const std::string &path)
+        : _mapping(path.c_str(), boost::interprocess::read_only),
+          _region(_mapping, boost::interprocess::read_only) {
+        if (_region.get_size() < sizeof(file_header_t) || memcmp(header().magic, file_magic, sizeof(file_magic)) != 0) {
+            throw std::runtime_error(path + " isn't a columnar table file");
+        }
+        if (_region.get_size() < sizeof(file_header_t) + sizeof(column_header_t) * header().columns) {
+            throw std::runtime_error(path + " is truncated");
+        }
+    }
+
+    uint64_t rows() const { return header().rows; }
+    uint64_t columns_count() const { return header().columns; }
+    const column_header_t &column(size_t index) const { return column_headers()[index]; }
+
+    const column_header_t *find_column(const std::string &name) const {
+        for (size_t i = 0; i < columns_count(); i++) {
+            if (name == column_headers()[i].name) {
+                return &column_headers()[i];
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename T>
+    const T *values(const std::string &name) const {
+        const column_header_t &column = get_column(name);
+        if (column.type == COLUMN_TEXT || column_width(static_cast<column_type_t>(column.type)) != sizeof(T)) {
+            throw std::logic_error("column " + name + " doesn't have values of the requested size");
+        }
+        return reinterpret_cast<const T *>(data() + column.offset);
+    }
+
+    std::pair<const char *, size_t> text(const std::string &name, uint64_t row) const {
+        const column_header_t &column = get_column(name);
+        if (column.type != COLUMN_TEXT) {
+            throw std::logic_error("column " + name + " isn't a text column");
+        }
+        const uint64_t *offsets = reinterpret_cast<const uint64_t *>(data() + column.offset);
+        return {data() + column.blob_offset + offsets[row], offsets[row + 1] - offsets[row]};
+    }
+
+private:
+    const char *data() const { return static_cast<const char *>(_region.get_address()); }
+    const file_header_t &header() const { return *reinterpret_cast<const file_header_t *>(data()); }
+    const column_header_t *column_headers() const {
+        return reinterpret_cast<const column_header_t *>(data() + sizeof(file_header_t));
+    }
+
+    const column_header_t &get_column(const std::string &name) const {
+        const column_header_t *column = find_column(name);
+        if (!column) {
+            throw std::out_of_range("column " + name + " isn't found");
+        }
+        return *column;
+    }
+
+    boost::interprocess::file_mapping _mapping;
+    boost::interprocess::mapped_region _region;
+};
+
+} // namespace snapshot
+} // namespace golos
@@ -0,0 +1,41 @@
+#include "table_exporter.hpp"
+
+#include <fc/io/json.hpp>
+
+#include <iostream>
+
+using namespace golos::snapshot;
+
+int main(int argc, char *argv[]) {
+    if (argc != 7) {
+        std::cerr << "usage: " << argv[0] << " <state dir> <state size mb> <contract account> <pool> <abi file> <output dir>" << std::endl;
+        return 1;
+    }
+
+    try {
+        // the state of a stopped node, opened read-only
+        chainbase::database db(argv[1], chainbase::database::read_only, std::stoull(argv[2]) * 1024 * 1024);
+        db.add_index<eosio::chain::table_id_multi_index>();
+        db.add_index<eosio::chain::key_value_index>();
+
+        const account_name contract(argv[3]);
+        const auto pool = eosio::chain::symbol::from_string(std::string("0,") + argv[4]).to_symbol_code();
+        table_exporter exporter(fc::json::from_file(argv[5]).as<abi_def>());
+        const std::string output_dir = argv[6];
+        const account_name scope = pool_scope(db, contract, pool);
+
+        for (const auto &table : exporter.abi().tables) {
+            const auto rows = read_rows(db, contract, scope, table.name);
+            const std::string path = output_dir + "/" + table.name.to_string() + ".col";
+            exporter.export_rows(table.name, rows).write(path);
+            std::cout << path << ": " << rows.size() << " rows" << std::endl;
+        }
+    } catch (const fc::exception &e) {
+        std::cerr << e.to_detail_string() << std::endl;
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "columnar.hpp"
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/block_timestamp.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <fc/crypto/sha256.hpp>
+
+// Exports the contract tables to the columnar files. The row layouts come from the contract ABI,
+// which is generated from the EOSLIB_SERIALIZE definitions of golos.worker.cpp: every fixed-width field
+// becomes a column, a nested struct is flattened to "field.subfield" columns and an asset to
+// "field.amount" and "field.symbol" columns. A binary extension field ("type$") missing from an older row
+// is exported as zero or an empty text. An optional field ("type?") gets a uint8 column "field?", 1 if the row
+// has the value, and the columns of the value are zero or empty in the rows without it.
+namespace golos {
+namespace snapshot {
+
+using eosio::chain::abi_def;
+using eosio::chain::abi_serializer;
+using eosio::chain::account_name;
+using eosio::chain::bytes;
+
+inline std::vector<bytes> read_rows(const chainbase::database &db, account_name code, account_name scope, account_name table) {
+    using namespace eosio::chain;
+
+    std::vector<bytes> rows;
+    const auto *table_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+    if (!table_id) {
+        return rows;
+    }
+
+    const auto &index = db.get_index<key_value_index, by_scope_primary>();
+    for (auto ptr = index.lower_bound(boost::make_tuple(table_id->id)); ptr != index.end() && ptr->t_id == table_id->id; ++ptr) {
+        rows.emplace_back(ptr->value.data(), ptr->value.data() + ptr->value.size());
+    }
+    return rows;
+}
+
+// the scope of the pool tables, follows worker::pool_scope(): the pool created before the pools were scoped
+// keeps its tables in the contract scope, the state row starts with the symbol of the pool
+inline account_name pool_scope(const chainbase::database &db, account_name code, eosio::chain::symbol_code pool) {
+    const auto state = read_rows(db, code, code, N(state));
+    uint64_t symbol = 0;
+    if (!state.empty() && state.front().size() >= sizeof(symbol)) {
+        memcpy(&symbol, state.front().data(), sizeof(symbol));
+        if (symbol >> 8 == pool.value) {
+            return code;
+        }
+    }
+    return account_name(pool.value);
+}
+
+class table_exporter {
+public:
+    table_exporter(const abi_def &abi, fc::microseconds max_time = fc::seconds(1))
+        : _abi_def(abi), _abi(abi, max_time), _max_time(max_time) {}
+
+    table_writer export_rows(account_name table, const std::vector<bytes> &rows) const {
+        const std::string type = table_type(table);
+
+        table_writer writer;
+        std::vector<field_t> fields;
+        add_fields(writer, fields, type, "", {});
+
+        for (const auto &row : rows) {
+            const fc::variant value = _abi.binary_to_variant(type, row, _max_time);
+            for (const auto &field : fields) {
+                push(writer, field, get(value, field.path));
+            }
+            writer.end_row();
+        }
+        return writer;
+    }
+
+    const abi_def &abi() const { return _abi_def; }
+
+private:
+    enum field_kind_t {
+        FIELD_INTEGER,
+        FIELD_NAME,
+        FIELD_SYMBOL,
+        FIELD_ASSET_AMOUNT,
+        FIELD_ASSET_SYMBOL,
+        FIELD_TIMESTAMP,
+        FIELD_CHECKSUM,
+        FIELD_TEXT,
+        FIELD_PRESENT
+    };
+
+    struct field_t {
+        std::vector<std::string> path;
+        field_kind_t kind;
+        size_t column;
+    };
+
+    std::string table_type(account_name table) const {
+        const std::string type = _abi.get_table_type(table);
+        FC_ASSERT(!type.empty(), "table ${table} isn't found in the ABI", ("table", table));
+        return type;
+    }
+
+    void add_field(table_writer &writer, std::vector<field_t> &fields, const std::string &column,
+                   std::vector<std::string> path, field_kind_t kind, column_type_t type) const {
+        fields.push_back(field_t{std::move(path), kind, writer.add_column(column, type)});
+    }
+
+    void add_fields(table_writer &writer, std::vector<field_t> &fields, const std::string &type,
+                    const std::string &prefix, const std::vector<std::string> &path) const {
+        const auto &struct_def = _abi.get_struct(_abi.resolve_type(type));
+        if (!struct_def.base.empty()) {
+            add_fields(writer, fields, struct_def.base, prefix, path);
+        }
+
+        for (const auto &field : struct_def.fields) {
+            const std::string column = prefix + field.name;
+            std::vector<std::string> field_path = path;
+            field_path.push_back(field.name);
+
+            std::string field_type = field.type;
+            if (!field_type.empty() && field_type.back() == '$') {
+                field_type.pop_back();
+            }
+            if (!field_type.empty() && field_type.back() == '?') {
+                field_type.pop_back();
+                add_field(writer, fields, column + "?", field_path, FIELD_PRESENT, COLUMN_UINT8);
+            }
+            field_type = _abi.resolve_type(field_type);
+            if (field_type == "bool" || field_type == "uint8" || field_type == "int8") {
+                add_field(writer, fields, column, field_path, FIELD_INTEGER, COLUMN_UINT8);
+            } else if (field_type == "uint16" || field_type == "int16") {
+                add_field(writer, fields, column, field_path, FIELD_INTEGER, COLUMN_UINT16);
+            } else if (field_type == "uint32" || field_type == "int32") {
+                add_field(writer, fields, column, field_path, FIELD_INTEGER, COLUMN_UINT32);
+            } else if (field_type == "uint64") {
+                add_field(writer, fields, column, field_path, FIELD_INTEGER, COLUMN_UINT64);
+            } else if (field_type == "int64") {
+                add_field(writer, fields, column, field_path, FIELD_INTEGER, COLUMN_INT64);
+            } else if (field_type == "name") {
+                add_field(writer, fields, column, field_path, FIELD_NAME, COLUMN_UINT64);
+            } else if (field_type == "symbol") {
+                add_field(writer, fields, column, field_path, FIELD_SYMBOL, COLUMN_UINT64);
+            } else if (field_type == "asset") {
+                add_field(writer, fields, column + ".amount", field_path, FIELD_ASSET_AMOUNT, COLUMN_INT64);
+                add_field(writer, fields, column + ".symbol", field_path, FIELD_ASSET_SYMBOL, COLUMN_UINT64);
+            } else if (field_type == "block_timestamp_type") {
+                add_field(writer, fields, column, field_path, FIELD_TIMESTAMP, COLUMN_UINT32);
+            } else if (field_type == "checksum256") {
+                add_field(writer, fields, column, field_path, FIELD_CHECKSUM, COLUMN_BYTES32);
+            } else if (field_type == "string") {
+                add_field(writer, fields, column, field_path, FIELD_TEXT, COLUMN_TEXT);
+            } else if (_abi.is_struct(field_type)) {
+                add_fields(writer, fields, field_type, column + ".", field_path);
+            } else {
+                FC_THROW("field ${field} of the type ${type} can't be exported", ("field", column)("type", field.type));
+            }
+        }
+    }
+
+    // null for a binary extension field missing from the row and for the fields of an optional value the row hasn't
+    static const fc::variant &get(const fc::variant &value, const std::vector<std::string> &path) {
+        static const fc::variant missing;
+        const fc::variant *field = &value;
+        for (const auto &name : path) {
+            if (field->is_null()) {
+                return missing;
+            }
+            const auto &object = field->get_object();
+            if (!object.contains(name.c_str())) {
+                return missing;
+            }
+            field = &object[name.c_str()];
+        }
+        return *field;
+    }
+
+    static void push(table_writer &writer, const field_t &field, const fc::variant &value) {
+        column_builder &column = writer.column(field.column);
+        if (value.is_null()) {
+            if (field.kind == FIELD_CHECKSUM) {
+                column.push_bytes32(fc::sha256().data());
+            } else if (field.kind == FIELD_TEXT) {
+                column.push_text("", 0);
+            } else {
+                column.push(uint64_t(0));
+            }
+            return;
+        }
+        switch (field.kind) {
+        case FIELD_INTEGER:
+            column.push(value.is_bool() ? uint64_t(value.as_bool()) :
+                        value.is_int64() ? uint64_t(value.as_int64()) : value.as_uint64());
+            break;
+        case FIELD_NAME:
+            column.push(value.as<account_name>().value);
+            break;
+        case FIELD_SYMBOL:
+            column.push(value.as<eosio::chain::symbol>().value());
+            break;
+        case FIELD_ASSET_AMOUNT:
+            column.push(static_cast<uint64_t>(value.as<eosio::chain::asset>().get_amount()));
+            break;
+        case FIELD_ASSET_SYMBOL:
+            column.push(value.as<eosio::chain::asset>().get_symbol().value());
+            break;
+        case FIELD_TIMESTAMP:
+            column.push(value.as<eosio::chain::block_timestamp_type>().slot);
+            break;
+        case FIELD_CHECKSUM:
+            column.push_bytes32(value.as<fc::sha256>().data());
+            break;
+        case FIELD_TEXT: {
+            const std::string &text = value.get_string();
+            column.push_text(text.data(), text.size());
+            break;
+        }
+        case FIELD_PRESENT:
+            column.push(uint64_t(1));
+            break;
+        }
+    }
+
+    abi_def _abi_def;
+    abi_serializer _abi;
+    fc::microseconds _max_time;
+};
+
+} // namespace snapshot
+} // namespace golos
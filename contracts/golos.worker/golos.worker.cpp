@@ -1,18 +1,29 @@
 #include <eosiolib/eosio.hpp>
 #include <eosiolib/asset.hpp>
 #include <eosiolib/action.hpp>
+#include <eosiolib/binary_extension.hpp>
 #include <eosiolib/time.hpp>
 #include <eosiolib/crypto.h>
+#include <eosiolib/fixed_bytes.hpp>
 #include <eosiolib/singleton.hpp>
 #include <eosiolib/symbol.hpp>
 #include <eosiolib/name.hpp>
 #include <eosiolib/serialize.hpp>
 
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
 #include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "external.hpp"
+#include "proposal_rules.hpp"
 
 using namespace eosio;
 using namespace std;
@@ -33,6 +44,292 @@ class [[eosio::contract]] worker : public contract
 {
 private:
     static constexpr uint32_t voting_time_s = 7 * 24 * 3600;
+    // rows of the losing tspec applications erased along with the selection or the expiry, the rest is left to reclaimtspec
+    static constexpr size_t reclaim_step_rows = 32;
+    // stale weights of the voter's votes refreshed by every vote of the voter, the rest is left to refreshvotes
+    static constexpr size_t refresh_batch_size = 8;
+    // the layout of the proposal, tspec application and comment rows, the older rows are upgraded by migrate.
+    // The version is a binary extension: the rows stored before it end right before it and are read without it (version 0)
+    static constexpr uint8_t row_version = 1;
+
+    // the pool of the running action, every pool keeps its tables in its own scope, see pool_scope()
+    const eosio::symbol_code _pool;
+
+    // text that refers to the action data (or to a string that outlives it), isn't copied on unpacking
+    struct text_view_t {
+        const char *data = nullptr;
+        uint32_t size = 0;
+
+        text_view_t() = default;
+        text_view_t(const string &text) : data(text.data()), size(text.size()) {}
+
+        bool empty() const { return size == 0; }
+
+        template<typename DataStream>
+        friend DataStream& operator<<(DataStream &ds, const text_view_t &text) {
+            ds << unsigned_int(text.size);
+            ds.write(text.data, text.size);
+            return ds;
+        }
+
+        template<typename DataStream>
+        friend DataStream& operator>>(DataStream &ds, text_view_t &text) {
+            unsigned_int size;
+            ds >> size;
+            eosio_assert(ds.remaining() >= size.value, "read");
+            text.data = ds.pos();
+            text.size = size.value;
+            ds.skip(size.value);
+            return ds;
+        }
+    };
+
+    struct [[eosio::table]] text_t {
+        uint64_t id;
+        checksum256 hash;
+        string text;
+        uint64_t refs;
+
+        EOSLIB_SERIALIZE(text_t, (id)(hash)(text)(refs));
+
+        uint64_t primary_key() const { return id; }
+        key256 by_hash() const { return hash; }
+    };
+
+    // texts are stored once and shared by all the rows that refer to them by sha256,
+    // empty text has a zero hash and doesn't take a row. A text row outlives the row that has added it while the others
+    // refer to it, so it is billed to the contract, the space is charged to the authors of the referring rows
+    struct texts_module_t {
+        multi_index<"texts"_n, text_t,
+            indexed_by<"hash"_n,
+                const_mem_fun<text_t, key256, &text_t::by_hash>>> texts;
+
+        texts_module_t(eosio::name code, uint64_t scope) : texts(code, scope) {}
+
+        static checksum256 get_hash(const text_view_t &text)
+        {
+            capi_checksum256 digest;
+            ::sha256(text.data, text.size, &digest);
+            return checksum256(digest.hash);
+        }
+
+        checksum256 add(const text_view_t &text)
+        {
+            if (text.empty()) {
+                return checksum256();
+            }
+            return add(get_hash(text), text);
+        }
+
+        // adds the text of the known hash
+        checksum256 add(const checksum256 &hash, const text_view_t &text)
+        {
+            auto index = texts.get_index<"hash"_n>();
+            auto ptr = index.find(hash);
+            if (ptr != index.end()) {
+                index.modify(ptr, name(), [&](text_t &obj) {
+                    obj.refs++;
+                });
+            } else {
+                texts.emplace(texts.get_code(), [&](text_t &obj) {
+                    obj.id = texts.available_primary_key();
+                    obj.hash = hash;
+                    obj.text.assign(text.data, text.size);
+                    obj.refs = 1;
+                });
+            }
+            return hash;
+        }
+
+        void release(const checksum256 &hash)
+        {
+            if (hash == checksum256()) {
+                return;
+            }
+
+            auto index = texts.get_index<"hash"_n>();
+            auto ptr = index.find(hash);
+            eosio_assert(ptr != index.end(), "text has not been found");
+            if (ptr->refs > 1) {
+                index.modify(ptr, name(), [&](text_t &obj) {
+                    obj.refs--;
+                });
+            } else {
+                index.erase(ptr);
+            }
+        }
+
+        // the new text is added before the old one is released, so re-posting the same text doesn't recreate its row
+        checksum256 replace(const checksum256 &hash, const text_view_t &text)
+        {
+            const checksum256 new_hash = add(text);
+            release(hash);
+            return new_hash;
+        }
+
+        size_t size(const checksum256 &hash) const
+        {
+            if (hash == checksum256()) {
+                return 0;
+            }
+
+            auto index = texts.get_index<"hash"_n>();
+            auto ptr = index.find(hash);
+            eosio_assert(ptr != index.end(), "text has not been found");
+            return ptr->text.size();
+        }
+    };
+    texts_module_t _texts;
+
+    // the table space taken by the rows of an account or of a proposal
+    struct [[eosio::table]] usage_t {
+        uint64_t id; // the account name or the proposal ID
+        uint64_t bytes;
+        uint32_t rows;
+
+        EOSLIB_SERIALIZE(usage_t, (id)(bytes)(rows));
+
+        uint64_t primary_key() const { return id; }
+    };
+
+    struct [[eosio::table("quotas")]] quotas_t {
+        uint64_t account_bytes;  // 0 is no limit
+        uint64_t proposal_bytes; // 0 is no limit
+
+        EOSLIB_SERIALIZE(quotas_t, (account_bytes)(proposal_bytes));
+    };
+
+    // counts the space by the authors of the rows rather than by the RAM payers, the payer of a proposal row changes
+    // with its state while the space stays the author's. The bytes approximate the RAM billing: the packed row,
+    // the text it refers to and the chain overheads per row and per secondary index. A proposal is charged with its row,
+    // applications and comments, the votes are charged to the voters only
+    struct usage_module_t {
+        static constexpr uint64_t no_proposal = std::numeric_limits<uint64_t>::max();
+        static constexpr int64_t row_overhead = 112;
+        static constexpr int64_t index_overhead = 128;
+
+        singleton<"quotas"_n, quotas_t> quotas;
+        multi_index<"usage"_n, usage_t> accounts;
+        multi_index<"propusage"_n, usage_t> proposals;
+
+        usage_module_t(eosio::name code, uint64_t scope) : quotas(code, scope), accounts(code, scope), proposals(code, scope) {}
+
+        template <typename T>
+        static int64_t row_bytes(const T &row, size_t indexes, size_t text_size = 0) {
+            return pack_size(row) + row_overhead + indexes * index_overhead + text_size;
+        }
+
+        // the rows posted before the accounting are refunded down to zero
+        static void count(usage_t &usage, int64_t bytes, int32_t rows) {
+            usage.bytes = bytes < 0 ? usage.bytes - std::min<uint64_t>(usage.bytes, -bytes) : usage.bytes + bytes;
+            usage.rows = rows < 0 ? usage.rows - std::min<uint32_t>(usage.rows, -rows) : usage.rows + rows;
+        }
+
+        template <typename Table>
+        static void update(Table &table, uint64_t id, eosio::name payer, int64_t bytes, int32_t rows, uint64_t limit, const char *error) {
+            auto usage_ptr = table.find(id);
+            usage_t usage = usage_ptr != table.end() ? *usage_ptr : usage_t{id, 0, 0};
+            count(usage, bytes, rows);
+            eosio_assert(bytes <= 0 || limit == 0 || usage.bytes <= limit, error);
+
+            if (usage.bytes == 0 && usage.rows == 0) {
+                if (usage_ptr != table.end()) {
+                    table.erase(usage_ptr);
+                }
+            } else if (usage_ptr == table.end()) {
+                table.emplace(payer, [&](usage_t &obj) {
+                    obj = usage;
+                });
+            } else {
+                table.modify(usage_ptr, name(), [&](usage_t &obj) {
+                    obj = usage;
+                });
+            }
+        }
+
+        // charges the change of the space to the account and to the proposal, rejects a growth over a quota.
+        // The usage rows created by the change are billed to the payer
+        void charge(eosio::name account, uint64_t proposal_id, int64_t bytes, int32_t rows, eosio::name payer) {
+            if (bytes == 0 && rows == 0) {
+                return;
+            }
+            const quotas_t limits = quotas.get_or_default(quotas_t{0, 0});
+            update(accounts, account.value, payer, bytes, rows, limits.account_bytes, "account RAM quota exceeded");
+            if (proposal_id != no_proposal) {
+                update(proposals, proposal_id, payer, bytes, rows, limits.proposal_bytes, "proposal RAM quota exceeded");
+            }
+        }
+
+        void erase_proposal(uint64_t proposal_id) {
+            auto usage_ptr = proposals.find(proposal_id);
+            if (usage_ptr != proposals.end()) {
+                proposals.erase(usage_ptr);
+            }
+        }
+    };
+    usage_module_t _usage;
+
+    // the rows of a table sharing a foreign ID, in the order of the "foreign" index. The upper bound of the group is looked up
+    // once, the rows are read and erased through the index iterators without looking them up by the primary key again.
+    // The upper bound is the first row of the next group, it stays valid as long as the rows of the other groups are kept
+    template <typename Table>
+    struct foreign_range_t {
+        using index_t = decltype(std::declval<Table &>().template get_index<"foreign"_n>());
+        using iterator_t = decltype(std::declval<const index_t &>().cbegin());
+
+        Table &table;
+        index_t index;
+        uint64_t foreign_id;
+        iterator_t upper;
+
+        foreign_range_t(Table &table, uint64_t foreign_id)
+            : table(table), index(table.template get_index<"foreign"_n>()), foreign_id(foreign_id),
+              upper(index.upper_bound(foreign_id)) {}
+
+        // the erased rows move the lower bound, so it is looked up by every operation
+        iterator_t begin() const { return index.lower_bound(foreign_id); }
+        iterator_t end() const { return upper; }
+
+        size_t count() const {
+            return std::distance(begin(), end());
+        }
+
+        template <typename Predicate>
+        size_t count(Predicate &&predicate) const {
+            return std::count_if(begin(), end(), predicate);
+        }
+
+        template <typename Predicate>
+        iterator_t find_if(Predicate &&predicate) const {
+            return std::find_if(begin(), end(), predicate);
+        }
+
+        // erases the row, the visitor goes first. Returns the next row
+        template <typename Visitor>
+        iterator_t erase(iterator_t ptr, Visitor &&visitor) {
+            visitor(*ptr);
+            iterator_t next = std::next(ptr);
+            table.erase(*ptr);
+            return next;
+        }
+
+        // erases at most `limit` rows from the beginning of the group, the visitor goes before every erase.
+        // Returns the number of the erased rows
+        template <typename Visitor>
+        size_t erase_n(size_t limit, Visitor &&visitor) {
+            size_t count = 0;
+            for (auto ptr = begin(); ptr != upper && count < limit; count++) {
+                ptr = erase(ptr, visitor);
+            }
+            return count;
+        }
+    };
+
+    // the range of a const table can only be read
+    template <typename Table>
+    static foreign_range_t<Table> foreign_range(Table &table, uint64_t foreign_id) {
+        return foreign_range_t<Table>(table, foreign_id);
+    }
 
     using comment_id_t = uint64_t;
     struct comment_data_t {
@@ -40,6 +337,16 @@ private:
 
         EOSLIB_SERIALIZE(comment_data_t, (text));
     };
+    struct comment_view_t {
+        text_view_t text;
+
+        comment_view_t() = default;
+        comment_view_t(const comment_data_t &that) : text(that.text) {}
+
+        EOSLIB_SERIALIZE(comment_view_t, (text));
+    };
+    // the rows posted before the text store keep the text in data, the newer ones leave data empty
+    // and refer to the text by text_hash
     struct [[eosio::table]] comment_t {
         comment_id_t id;
         uint64_t foreign_id;
@@ -47,60 +354,136 @@ private:
         comment_data_t data;
         block_timestamp created;
         block_timestamp modified;
+        binary_extension<checksum256> text_hash;
+        binary_extension<uint32_t> text_size;
+        binary_extension<uint8_t> version;
 
-        EOSLIB_SERIALIZE(comment_t, (id)(foreign_id)(author)(data)(created)(modified));
+        EOSLIB_SERIALIZE(comment_t, (id)(foreign_id)(author)(data)(created)(modified)(text_hash)(text_size)(version));
 
         uint64_t primary_key() const { return id; }
         uint64_t get_secondary_1() const { return foreign_id; }
+        // comments of the foreign object in the order of creation
+        uint128_t by_created() const { return (uint128_t(foreign_id) << 64) | created.slot; }
     };
 
-    template <eosio::name::raw TableName>
+    enum comment_storage_t {
+        STORE_TEXT, // the text is kept in the text store
+        STORE_HASH  // only sha256 and size of the text are kept, the text itself is available from the action data
+    };
+
+    template <eosio::name::raw TableName, comment_storage_t Storage = STORE_TEXT>
     struct comments_module_t {
         multi_index<TableName, comment_t,
             indexed_by<"foreign"_n,
-                const_mem_fun<comment_t, uint64_t, &comment_t::get_secondary_1>>> comments;
+                const_mem_fun<comment_t, uint64_t, &comment_t::get_secondary_1>>,
+            indexed_by<"created"_n,
+                const_mem_fun<comment_t, uint128_t, &comment_t::by_created>>> comments;
+        texts_module_t &texts;
+        usage_module_t *usage;
+        bool by_proposal;
+
+        // the usage of the comments is charged to the author and to the proposal of the foreign ID,
+        // the comments of the other foreign objects are charged to the author only
+        comments_module_t(eosio::name code, uint64_t scope, texts_module_t &texts, usage_module_t *usage = nullptr, bool by_proposal = true)
+            : comments(code, scope), texts(texts), usage(usage), by_proposal(by_proposal) {}
+
+        static int64_t usage_of(const comment_t &comment) {
+            return usage_module_t::row_bytes(comment, 2, Storage == STORE_TEXT ? comment.text_size.value_or() : 0);
+        }
+
+        void charge(const comment_t &comment, bool add, eosio::name payer) {
+            if (usage) {
+                const uint64_t proposal_id = by_proposal ? comment.foreign_id : usage_module_t::no_proposal;
+                usage->charge(comment.author, proposal_id, add ? usage_of(comment) : -usage_of(comment), add ? 1 : -1, payer);
+            }
+        }
+
+        void charge(const comment_t &comment, bool add) {
+            charge(comment, add, comment.author);
+        }
 
-        comments_module_t(eosio::name code, uint64_t scope) : comments(code, scope) {}
+        // whether the text hash of a comment refers to the text store
+        static constexpr bool keeps_text() {
+            return Storage == STORE_TEXT;
+        }
+
+        checksum256 store_text(const text_view_t &text)
+        {
+            if (Storage == STORE_HASH) {
+                return text.empty() ? checksum256() : texts_module_t::get_hash(text);
+            }
+            return texts.add(text);
+        }
+
+        void release_text(const checksum256 &hash)
+        {
+            if (Storage == STORE_TEXT) {
+                texts.release(hash);
+            }
+        }
 
-        void add(comment_id_t id, uint64_t foreign_id, eosio::name author, const comment_data_t &data)
+        void add(comment_id_t id, uint64_t foreign_id, eosio::name author, const comment_view_t &data)
         {
             eosio_assert(comments.find(id) == comments.end(), "comment exists");
-            comments.emplace(author, [&](auto &obj) {
+            auto comment_ptr = comments.emplace(author, [&](auto &obj) {
                 obj.id = id;
                 obj.author = author;
-                obj.data = data;
+                obj.text_hash.emplace(store_text(data.text));
+                obj.text_size.emplace(data.text.size);
                 obj.foreign_id = foreign_id;
                 obj.created = TIMESTAMP_NOW;
                 obj.modified = TIMESTAMP_UNDEFINED;
+                obj.version.emplace(row_version);
             });
+            charge(*comment_ptr, true);
         }
 
         void del(comment_id_t id)
         {
             const auto& comment = comments.get(id);
             require_auth(comment.author);
+            charge(comment, false);
+            release_text(comment.text_hash.value_or());
             comments.erase(comment);
         }
 
-        void edit(comment_id_t id, const comment_data_t &data)
+        // moves the text of a comment posted before the text store out of the row, see migrate
+        void upgrade(comment_t &obj)
+        {
+            if (!obj.text_hash.has_value()) {
+                obj.text_hash.emplace(store_text(obj.data.text));
+                obj.text_size.emplace(obj.data.text.size());
+                obj.data.text.clear();
+            }
+        }
+
+        void edit(comment_id_t id, const comment_view_t &data)
         {
             eosio_assert(!data.text.empty(), "nothing to change");
             const auto &comment = comments.get(id);
             require_auth(comment.author);
 
+            charge(comment, false);
             comments.modify(comment, comment.author, [&](comment_t &obj) {
-                obj.data.text = data.text;
+                const checksum256 text_hash = store_text(data.text);
+                release_text(obj.text_hash.value_or());
+                obj.data.text.clear();
+                obj.text_hash.emplace(text_hash);
+                obj.text_size.emplace(data.text.size);
             });
+            charge(comment, true);
         }
 
-        void erase_all(uint64_t foreign_id) {
-            auto index = comments.template get_index<name("foreign")>();
-            auto ptr = index.lower_bound(foreign_id);
-            while (ptr != index.upper_bound(foreign_id)) {
-                comment_id_t id = ptr->id;
-                ptr++;
-                comments.erase(comments.get(id));
-            }
+        size_t count(uint64_t foreign_id) const {
+            return foreign_range(comments, foreign_id).count();
+        }
+
+        // erases at most `limit` comments, returns the number of the erased ones
+        size_t erase_all(uint64_t foreign_id, size_t limit = std::numeric_limits<size_t>::max()) {
+            return foreign_range(comments, foreign_id).erase_n(limit, [&](const comment_t &comment) {
+                charge(comment, false);
+                release_text(comment.text_hash.value_or());
+            });
         }
     };
 
@@ -112,65 +495,672 @@ private:
 
         uint64_t primary_key() const { return id; }
         uint64_t get_secondary_1() const { return foreign_id; }
+        uint128_t by_voter() const { return (uint128_t(voter.value) << 64) | id; }
 
         EOSLIB_SERIALIZE(vote_t, (id)(foreign_id)(voter)(positive));
     };
 
+    // events are inline actions sent by the contract to itself, indexers read them from the action traces
+    template <typename... Args>
+    static void send_event(eosio::name self, eosio::name event, const Args&... args) {
+        action(permission_level{self, "active"_n}, self, event, std::make_tuple(args...)).send();
+    }
+
+    static constexpr uint64_t no_vote = std::numeric_limits<uint64_t>::max();
+
+    enum vote_event_t : int8_t {
+        VOTE_NEGATIVE = -1,
+        VOTE_REVOKED = 0,
+        VOTE_POSITIVE = 1
+    };
+
+    // a node of the Merkle sum tree over the votes for one foreign object, every node commits to the tally of its subtree.
+    // A leaf is sha256(voter, positive), an inner node is sha256(left hash, left tally, right hash, right tally),
+    // an empty node has a zero hash and no row
+    struct [[eosio::table]] vote_node_t {
+        uint64_t id;
+        uint64_t foreign_id;
+        uint64_t position; // level << 56 | index within the level, the leaves are at the level 0
+        uint64_t vote_id;  // the vote of a leaf, no_vote for an inner node
+        checksum256 hash;
+        uint32_t positive;
+        uint32_t negative;
+
+        EOSLIB_SERIALIZE(vote_node_t, (id)(foreign_id)(position)(vote_id)(hash)(positive)(negative));
+
+        uint64_t primary_key() const { return id; }
+        uint128_t by_position() const { return (uint128_t(foreign_id) << 64) | position; }
+        uint64_t by_vote() const { return vote_id; }
+        bool empty() const { return positive == 0 && negative == 0; }
+    };
+
+    // the root of the tree, a client verifies a tally or a vote against this row with the sibling nodes of the leaf
+    struct [[eosio::table]] vote_root_t {
+        uint64_t foreign_id;
+        uint32_t count; // the leaves take the indexes from 0 to count - 1
+        uint8_t depth;
+        checksum256 hash;
+        uint32_t positive;
+        uint32_t negative;
+
+        EOSLIB_SERIALIZE(vote_root_t, (foreign_id)(count)(depth)(hash)(positive)(negative));
+
+        uint64_t primary_key() const { return foreign_id; }
+    };
+
+    // keeps the tree in O(log n) rows reads and writes per vote change: a new vote takes the next leaf,
+    // a removed one is replaced by the last leaf, so the leaves stay dense and the depth is log2 of the votes count
+    struct vote_tree_module_t {
+        multi_index<"votenodes"_n, vote_node_t,
+            indexed_by<"position"_n, const_mem_fun<vote_node_t, uint128_t, &vote_node_t::by_position>>,
+            indexed_by<"vote"_n, const_mem_fun<vote_node_t, uint64_t, &vote_node_t::by_vote>>> nodes;
+        multi_index<"voteroots"_n, vote_root_t> roots;
+
+        vote_tree_module_t(eosio::name code, uint64_t scope) : nodes(code, scope), roots(code, scope) {}
+
+        static uint64_t position(uint8_t level, uint64_t index) { return (uint64_t(level) << 56) | index; }
+
+        static vote_node_t make_leaf(const vote_t &vote) {
+            char buffer[sizeof(uint64_t) + sizeof(bool)];
+            datastream<char *> ds(buffer, sizeof(buffer));
+            ds << vote.voter << vote.positive;
+
+            vote_node_t leaf{.foreign_id = vote.foreign_id, .vote_id = vote.id, .positive = vote.positive, .negative = !vote.positive};
+            capi_checksum256 digest;
+            ::sha256(buffer, sizeof(buffer), &digest);
+            leaf.hash = checksum256(digest.hash);
+            return leaf;
+        }
+
+        static vote_node_t make_inner(const vote_node_t &left, const vote_node_t &right) {
+            vote_node_t node{.foreign_id = left.foreign_id, .vote_id = no_vote, .positive = left.positive + right.positive,
+                .negative = left.negative + right.negative};
+            if (!node.empty()) {
+                char buffer[2 * (sizeof(checksum256) + 2 * sizeof(uint32_t))];
+                datastream<char *> ds(buffer, sizeof(buffer));
+                ds << left.hash << left.positive << left.negative << right.hash << right.positive << right.negative;
+
+                capi_checksum256 digest;
+                ::sha256(buffer, sizeof(buffer), &digest);
+                node.hash = checksum256(digest.hash);
+            }
+            return node;
+        }
+
+        vote_node_t get(uint64_t foreign_id, uint8_t level, uint64_t index) const {
+            auto position_index = nodes.get_index<"position"_n>();
+            auto ptr = position_index.find((uint128_t(foreign_id) << 64) | position(level, index));
+            return ptr != position_index.end() ? *ptr : vote_node_t{.foreign_id = foreign_id};
+        }
+
+        void set(uint8_t level, uint64_t index, const vote_node_t &node, eosio::name payer) {
+            auto position_index = nodes.get_index<"position"_n>();
+            auto ptr = position_index.find((uint128_t(node.foreign_id) << 64) | position(level, index));
+            if (node.empty()) {
+                if (ptr != position_index.end()) {
+                    position_index.erase(ptr);
+                }
+            } else if (ptr == position_index.end()) {
+                nodes.emplace(payer, [&](vote_node_t &obj) {
+                    obj = node;
+                    obj.id = nodes.available_primary_key();
+                    obj.position = position(level, index);
+                });
+            } else {
+                position_index.modify(ptr, name(), [&](vote_node_t &obj) {
+                    obj.vote_id = node.vote_id;
+                    obj.hash = node.hash;
+                    obj.positive = node.positive;
+                    obj.negative = node.negative;
+                });
+            }
+        }
+
+        // recounts the inner nodes from the leaf to the root
+        void update_path(uint64_t foreign_id, uint64_t leaf_index, uint8_t depth, eosio::name payer) {
+            for (uint8_t level = 1; level <= depth; level++) {
+                const uint64_t index = leaf_index >> level;
+                set(level, index, make_inner(get(foreign_id, level - 1, 2 * index), get(foreign_id, level - 1, 2 * index + 1)), payer);
+            }
+        }
+
+        void set_root(uint64_t foreign_id, uint32_t count, uint8_t depth, eosio::name payer) {
+            auto root_ptr = roots.find(foreign_id);
+            if (count == 0) {
+                if (root_ptr != roots.end()) {
+                    roots.erase(root_ptr);
+                }
+                return;
+            }
+
+            const vote_node_t top = get(foreign_id, depth, 0);
+            auto fill = [&](vote_root_t &obj) {
+                obj.foreign_id = foreign_id;
+                obj.count = count;
+                obj.depth = depth;
+                obj.hash = top.hash;
+                obj.positive = top.positive;
+                obj.negative = top.negative;
+            };
+            if (root_ptr == roots.end()) {
+                roots.emplace(payer, fill);
+            } else {
+                roots.modify(root_ptr, name(), fill);
+            }
+        }
+
+        void insert(const vote_t &vote, eosio::name payer) {
+            auto root_ptr = roots.find(vote.foreign_id);
+            uint32_t count = root_ptr != roots.end() ? root_ptr->count : 0;
+            uint8_t depth = root_ptr != roots.end() ? root_ptr->depth : 0;
+
+            const uint64_t leaf_index = count++;
+            while ((uint64_t(1) << depth) < count) {
+                depth++;
+            }
+            set(0, leaf_index, make_leaf(vote), payer);
+            update_path(vote.foreign_id, leaf_index, depth, payer);
+            set_root(vote.foreign_id, count, depth, payer);
+        }
+
+        void update(const vote_t &vote) {
+            auto vote_index = nodes.get_index<"vote"_n>();
+            auto leaf_ptr = vote_index.find(vote.id);
+            if (leaf_ptr == vote_index.end()) {
+                // the vote was cast before the tree was kept
+                insert(vote, vote.voter);
+                return;
+            }
+
+            const vote_root_t &root = roots.get(vote.foreign_id);
+            const uint64_t leaf_index = leaf_ptr->position;
+            set(0, leaf_index, make_leaf(vote), name());
+            update_path(vote.foreign_id, leaf_index, root.depth, vote.voter);
+            set_root(vote.foreign_id, root.count, root.depth, name());
+        }
+
+        void remove(const vote_t &vote) {
+            auto vote_index = nodes.get_index<"vote"_n>();
+            auto leaf_ptr = vote_index.find(vote.id);
+            if (leaf_ptr == vote_index.end()) {
+                return;
+            }
+
+            const vote_root_t &root = roots.get(vote.foreign_id);
+            uint32_t count = root.count;
+            uint8_t depth = root.depth;
+            const uint64_t leaf_index = leaf_ptr->position;
+            const uint64_t last_index = --count;
+
+            const vote_node_t last = get(vote.foreign_id, 0, last_index);
+            set(0, last_index, vote_node_t{.foreign_id = vote.foreign_id}, name());
+            update_path(vote.foreign_id, last_index, depth, name());
+            if (leaf_index != last_index) {
+                set(0, leaf_index, last, name());
+                update_path(vote.foreign_id, leaf_index, depth, name());
+            }
+
+            // the top levels over a single subtree are dropped
+            for (; depth > 0 && (uint64_t(1) << (depth - 1)) >= count; depth--) {
+                set(depth, 0, vote_node_t{.foreign_id = vote.foreign_id}, name());
+            }
+            set_root(vote.foreign_id, count, depth, name());
+        }
+
+        void clear(uint64_t foreign_id) {
+            auto position_index = nodes.get_index<"position"_n>();
+            auto ptr = position_index.lower_bound(uint128_t(foreign_id) << 64);
+            while (ptr != position_index.end() && ptr->foreign_id == foreign_id) {
+                ptr = position_index.erase(ptr);
+            }
+
+            auto root_ptr = roots.find(foreign_id);
+            if (root_ptr != roots.end()) {
+                roots.erase(root_ptr);
+            }
+        }
+    };
+
+    // the stake weight of a vote, taken from the voter balance when the vote is cast and refreshed after the balance changes
+    struct [[eosio::table]] vote_weight_t {
+        uint64_t vote_id;
+        uint64_t foreign_id;
+        eosio::name voter;
+        bool positive;
+        uint64_t weight;
+        uint64_t revision; // the revision of the voter weight the snapshot is taken from, see weight_of()
+
+        EOSLIB_SERIALIZE(vote_weight_t, (vote_id)(foreign_id)(voter)(positive)(weight)(revision));
+
+        uint64_t primary_key() const { return vote_id; }
+        // the stale snapshots of a voter go first
+        uint128_t by_revision() const { return (uint128_t(voter.value) << 64) | revision; }
+    };
+
+    // the sum of the vote weights for one foreign object
+    struct [[eosio::table]] weighted_tally_t {
+        uint64_t foreign_id;
+        uint32_t count;
+        uint64_t positive;
+        uint64_t negative;
+
+        EOSLIB_SERIALIZE(weighted_tally_t, (foreign_id)(count)(positive)(negative));
+
+        uint64_t primary_key() const { return foreign_id; }
+    };
+
+    // stands in for the golos.vest balance of the app domain member until the contract reads it from there
+    struct [[eosio::table]] balance_t {
+        eosio::name account;
+        asset quantity;
+        uint64_t revision; // incremented by every change, the snapshots of the older revisions are stale
+
+        EOSLIB_SERIALIZE(balance_t, (account)(quantity)(revision));
+
+        uint64_t primary_key() const { return account.value; }
+    };
+
+    // the weight delegated to the proxy account, cached to weigh a proxy vote without visiting the delegators.
+    // The row stays when the last delegator leaves, so the revision of the proxy weight never goes back
+    struct [[eosio::table]] proxy_t {
+        eosio::name account;
+        uint32_t delegators;
+        uint64_t weight;
+        uint64_t revision; // incremented by every change of the delegated weight
+
+        EOSLIB_SERIALIZE(proxy_t, (account)(delegators)(weight)(revision));
+
+        uint64_t primary_key() const { return account.value; }
+    };
+
+    struct [[eosio::table]] delegation_t {
+        eosio::name account;
+        eosio::name proxy;
+
+        EOSLIB_SERIALIZE(delegation_t, (account)(proxy));
+
+        uint64_t primary_key() const { return account.value; }
+    };
+
+    struct [[eosio::table("weighting")]] weighting_t {
+        block_timestamp enabled;
+
+        EOSLIB_SERIALIZE(weighting_t, (enabled));
+    };
+
+    // keeps a weight snapshot per vote and the weighted tallies once the pool weighs the votes. A balance change
+    // doesn't touch the votes, their snapshots get stale and are refreshed by refresh() in batches of a bounded size
+    struct vote_weights_module_t {
+        singleton<"weighting"_n, weighting_t> weighting;
+        multi_index<"balances"_n, balance_t> balances;
+        multi_index<"proxies"_n, proxy_t> proxies;
+        multi_index<"delegations"_n, delegation_t> delegations;
+        multi_index<"voteweights"_n, vote_weight_t,
+            indexed_by<"revision"_n, const_mem_fun<vote_weight_t, uint128_t, &vote_weight_t::by_revision>>> snapshots;
+        multi_index<"tallies"_n, weighted_tally_t> tallies;
+
+        vote_weights_module_t(const eosio::name &code, uint64_t scope)
+            : weighting(code, scope), balances(code, scope), proxies(code, scope), delegations(code, scope), snapshots(code, scope), tallies(code, scope) {}
+
+        // an account without a balance has no weight
+        balance_t balance_of(eosio::name account) const {
+            auto balance_ptr = balances.find(account.value);
+            return balance_ptr != balances.end() ? *balance_ptr : balance_t{account, asset(), 0};
+        }
+
+        struct weight_t {
+            uint64_t weight;
+            uint64_t revision;
+        };
+
+        // the own balance of the account unless it is delegated, plus the weight delegated to the account.
+        // Both revisions only grow, so their sum grows with every change of the weight
+        weight_t weight_of(eosio::name account) const {
+            const balance_t balance = balance_of(account);
+            weight_t weight{0, balance.revision};
+            if (delegations.find(account.value) == delegations.end()) {
+                weight.weight = balance.quantity.amount;
+            }
+            auto proxy_ptr = proxies.find(account.value);
+            if (proxy_ptr != proxies.end()) {
+                weight.weight += proxy_ptr->weight;
+                weight.revision += proxy_ptr->revision;
+            }
+            return weight;
+        }
+
+        void set_balance(eosio::name account, const asset &quantity, eosio::name payer) {
+            auto balance_ptr = balances.find(account.value);
+            const int64_t previous = balance_ptr != balances.end() ? balance_ptr->quantity.amount : 0;
+            if (balance_ptr == balances.end()) {
+                balances.emplace(payer, [&](balance_t &obj) {
+                    obj = balance_t{account, quantity, 1};
+                });
+            } else {
+                balances.modify(balance_ptr, name(), [&](balance_t &obj) {
+                    obj.quantity = quantity;
+                    obj.revision++;
+                });
+            }
+
+            auto delegation_ptr = delegations.find(account.value);
+            if (delegation_ptr != delegations.end()) {
+                update_proxy(delegation_ptr->proxy, payer, [&](proxy_t &obj) {
+                    obj.weight = obj.weight - previous + quantity.amount;
+                });
+            }
+        }
+
+        template <typename Lambda>
+        void update_proxy(eosio::name proxy, eosio::name payer, Lambda &&updater) {
+            auto proxy_ptr = proxies.find(proxy.value);
+            if (proxy_ptr == proxies.end()) {
+                proxy_ptr = proxies.emplace(payer, [&](proxy_t &obj) {
+                    obj = proxy_t{proxy, 0, 0, 0};
+                });
+            }
+            proxies.modify(proxy_ptr, name(), [&](proxy_t &obj) {
+                updater(obj);
+                obj.revision++;
+            });
+        }
+
+        // moves the weight of the account from its current proxy to the new one, an empty proxy returns the weight
+        // to the account. The votes of the account and of both proxies get stale, they aren't visited here
+        void set_proxy(eosio::name account, eosio::name proxy, eosio::name payer) {
+            auto delegation_ptr = delegations.find(account.value);
+            const eosio::name current = delegation_ptr != delegations.end() ? delegation_ptr->proxy : name();
+            eosio_assert(current != proxy, "the proxy is already set");
+            if (proxy != name()) {
+                auto own_proxy_ptr = proxies.find(account.value);
+                eosio_assert(own_proxy_ptr == proxies.end() || own_proxy_ptr->delegators == 0, "a proxy can't delegate its votes");
+                eosio_assert(delegations.find(proxy.value) == delegations.end(), "the proxy delegates its votes");
+            }
+
+            auto balance_ptr = balances.find(account.value);
+            const uint64_t weight = balance_ptr != balances.end() ? balance_ptr->quantity.amount : 0;
+            if (current != name()) {
+                update_proxy(current, payer, [&](proxy_t &obj) {
+                    obj.delegators--;
+                    obj.weight -= weight;
+                });
+            }
+            if (proxy != name()) {
+                update_proxy(proxy, payer, [&](proxy_t &obj) {
+                    obj.delegators++;
+                    obj.weight += weight;
+                });
+            }
+
+            if (proxy == name()) {
+                delegations.erase(delegation_ptr);
+            } else if (delegation_ptr == delegations.end()) {
+                delegations.emplace(account, [&](delegation_t &obj) {
+                    obj = delegation_t{account, proxy};
+                });
+            } else {
+                delegations.modify(delegation_ptr, name(), [&](delegation_t &obj) {
+                    obj.proxy = proxy;
+                });
+            }
+
+            // the own votes of the account are weighed with its balance or nothing now
+            if (balance_ptr != balances.end()) {
+                balances.modify(balance_ptr, name(), [&](balance_t &obj) {
+                    obj.revision++;
+                });
+            }
+        }
+
+        static void count(weighted_tally_t &tally, const vote_weight_t &snapshot, bool add) {
+            uint64_t &weight = snapshot.positive ? tally.positive : tally.negative;
+            weight = add ? weight + snapshot.weight : weight - snapshot.weight;
+        }
+
+        // the tally is created by the first vote and erased with the last one
+        template <typename Lambda>
+        void update_tally(uint64_t foreign_id, eosio::name payer, Lambda &&updater) {
+            auto tally_ptr = tallies.find(foreign_id);
+            if (tally_ptr == tallies.end()) {
+                tallies.emplace(payer, [&](weighted_tally_t &obj) {
+                    obj = weighted_tally_t{foreign_id, 0, 0, 0};
+                    updater(obj);
+                });
+            } else {
+                tallies.modify(tally_ptr, name(), updater);
+                if (tally_ptr->count == 0) {
+                    tallies.erase(tally_ptr);
+                }
+            }
+        }
+
+        void insert(const vote_t &vote, eosio::name payer) {
+            if (!weighting.exists()) {
+                return;
+            }
+            const weight_t weight = weight_of(vote.voter);
+            const vote_weight_t snapshot{vote.id, vote.foreign_id, vote.voter, vote.positive, weight.weight, weight.revision};
+            snapshots.emplace(payer, [&](vote_weight_t &obj) {
+                obj = snapshot;
+            });
+            update_tally(vote.foreign_id, payer, [&](weighted_tally_t &obj) {
+                obj.count++;
+                count(obj, snapshot, true);
+            });
+        }
+
+        // recounts the snapshot with the current side of the vote and the current weight of the voter
+        void reweigh(const vote_weight_t &snapshot, bool positive, const weight_t &weight) {
+            vote_weight_t updated = snapshot;
+            updated.positive = positive;
+            updated.weight = weight.weight;
+            updated.revision = weight.revision;
+            update_tally(snapshot.foreign_id, name(), [&](weighted_tally_t &obj) {
+                count(obj, snapshot, false);
+                count(obj, updated, true);
+            });
+            snapshots.modify(snapshot, name(), [&](vote_weight_t &obj) {
+                obj = updated;
+            });
+        }
+
+        void update(const vote_t &vote) {
+            auto snapshot_ptr = snapshots.find(vote.id);
+            if (snapshot_ptr == snapshots.end()) {
+                insert(vote, vote.voter);
+                return;
+            }
+            reweigh(*snapshot_ptr, vote.positive, weight_of(vote.voter));
+        }
+
+        void remove(const vote_t &vote) {
+            auto snapshot_ptr = snapshots.find(vote.id);
+            if (snapshot_ptr == snapshots.end()) {
+                return;
+            }
+            update_tally(vote.foreign_id, name(), [&](weighted_tally_t &obj) {
+                obj.count--;
+                count(obj, *snapshot_ptr, false);
+            });
+            snapshots.erase(snapshot_ptr);
+        }
+
+        // refreshes at most `limit` stale snapshots of the voter, returns the number of the refreshed ones
+        size_t refresh(eosio::name voter, size_t limit) {
+            if (!weighting.exists()) {
+                return 0;
+            }
+            const weight_t weight = weight_of(voter);
+            auto index = snapshots.get_index<"revision"_n>();
+            auto ptr = index.lower_bound(uint128_t(voter.value) << 64);
+            size_t refreshed = 0;
+            for (; ptr != index.end() && ptr->voter == voter && ptr->revision < weight.revision && refreshed < limit; refreshed++) {
+                const vote_weight_t &snapshot = *ptr;
+                ptr++;
+                reweigh(snapshot, snapshot.positive, weight);
+            }
+            return refreshed;
+        }
+    };
+
     template <eosio::name::raw TableName>
     struct voting_module_t {
-        multi_index<TableName, vote_t, indexed_by<"foreign"_n, const_mem_fun<vote_t, uint64_t, &vote_t::get_secondary_1>>> votes;
+        // the voter index lists the votes of an account in the order of their IDs
+        multi_index<TableName, vote_t,
+            indexed_by<"foreign"_n, const_mem_fun<vote_t, uint64_t, &vote_t::get_secondary_1>>,
+            indexed_by<"voter"_n, const_mem_fun<vote_t, uint128_t, &vote_t::by_voter>>> votes;
+        eosio::symbol_code pool;
+        vote_tree_module_t *tree;
+        vote_weights_module_t *weights;
+        usage_module_t *usage;
+
+        voting_module_t(const eosio::name& code, uint64_t scope, eosio::symbol_code pool, vote_tree_module_t *tree = nullptr,
+                        vote_weights_module_t *weights = nullptr, usage_module_t *usage = nullptr)
+            : votes(code, scope), pool(pool), tree(tree), weights(weights), usage(usage) {}
+
+        // the votes are charged to the voters only
+        void charge(const vote_t &vote, bool add, eosio::name payer) {
+            if (usage) {
+                const int64_t bytes = usage_module_t::row_bytes(vote, 2);
+                usage->charge(vote.voter, usage_module_t::no_proposal, add ? bytes : -bytes, add ? 1 : -1, payer);
+            }
+        }
 
-        voting_module_t(const eosio::name& code, uint64_t scope) : votes(code, scope) {}
+        void charge(const vote_t &vote, bool add) {
+            charge(vote, add, vote.voter);
+        }
+
+        void notify(uint64_t foreign_id, const eosio::name &voter, vote_event_t vote) const {
+            send_event(votes.get_code(), "eventvote"_n, pool, eosio::name(TableName), foreign_id, voter, static_cast<int8_t>(vote));
+        }
 
         size_t count_positive(uint64_t foreign_id) const {
-            auto index = votes.template get_index<name("foreign")>();
-            return std::count_if(index.lower_bound(foreign_id), index.upper_bound(foreign_id), [&](const vote_t &vote) {
+            return foreign_range(votes, foreign_id).count([&](const vote_t &vote) {
                 return vote.positive;
             });
         }
 
-        size_t count_negative(uint64_t foreign_id) const {
-            auto index = votes.template get_index<"foreign"_n>();
-            return std::count_if(index.lower_bound(foreign_id), index.upper_bound(foreign_id), [&](const vote_t &vote) {
-                return !vote.positive;
+        size_t count_negative(uint64_t foreign_id) const {
+            return foreign_range(votes, foreign_id).count([&](const vote_t &vote) {
+                return !vote.positive;
+            });
+        }
+
+        // returns the previous vote of the voter, VOTE_REVOKED if there was none
+        vote_event_t vote(const vote_t &vote) {
+            auto range = foreign_range(votes, vote.foreign_id);
+            auto row_ptr = range.find_if([&](const vote_t &row) {
+                return row.voter == vote.voter;
+            });
+            if (row_ptr != range.end()) {
+                eosio_assert(row_ptr->positive != vote.positive, "the vote already exists");
+                const vote_t &row = *row_ptr;
+                votes.modify(row, vote.voter, [&](auto &obj) {
+                    obj.positive = vote.positive;
+                });
+                if (tree) {
+                    tree->update(row);
+                }
+                if (weights) {
+                    weights->update(row);
+                }
+                notify(vote.foreign_id, vote.voter, vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE);
+                return vote.positive ? VOTE_NEGATIVE : VOTE_POSITIVE;
+            }
+            auto vote_ptr = votes.emplace(vote.voter, [&](auto &obj) {
+                obj = vote;
+                obj.id = votes.available_primary_key();
+            });
+            if (tree) {
+                tree->insert(*vote_ptr, vote.voter);
+            }
+            if (weights) {
+                weights->insert(*vote_ptr, vote.voter);
+            }
+            charge(*vote_ptr, true);
+            notify(vote.foreign_id, vote.voter, vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE);
+            return VOTE_REVOKED;
+        }
+
+        // erases at most `limit` votes, returns the number of the erased ones
+        size_t erase_all(uint64_t foreign_id, size_t limit = std::numeric_limits<size_t>::max()) {
+            if (tree) {
+                // the tree of the votes erased in part would be recounted per vote
+                eosio_assert(limit == std::numeric_limits<size_t>::max(), "votes with a tree can be erased only all at once");
+                tree->clear(foreign_id);
+            }
+            return foreign_range(votes, foreign_id).erase_n(limit, [&](const vote_t &vote) {
+                if (weights) {
+                    weights->remove(vote);
+                }
+                charge(vote, false);
             });
         }
 
-        void vote(const vote_t &vote) {
-            auto index = votes.template get_index<"foreign"_n>();
-            for (auto vote_ptr = index.lower_bound(vote.foreign_id); vote_ptr != index.upper_bound(vote.foreign_id); vote_ptr++) {
-                if (vote_ptr->voter == vote.voter) {
-                    eosio_assert(vote_ptr->positive != vote.positive, "the vote already exists");
-                    votes.modify(votes.get(vote_ptr->id), vote.voter, [&](auto &obj) {
-                        obj.positive = vote.positive;
-                    });
-                    return;
+        // visits the votes of the voter starting from the vote `from_id` while `limit` allows, erases the ones
+        // the predicate accepts. Returns the ID of the vote to start the next call from, no_vote if none are left
+        template <typename Predicate>
+        uint64_t revoke(const eosio::name &voter, uint64_t from_id, size_t &limit, Predicate &&predicate) {
+            auto index = votes.template get_index<"voter"_n>();
+            auto ptr = index.lower_bound((uint128_t(voter.value) << 64) | from_id);
+            for (; ptr != index.end() && ptr->voter == voter && limit > 0; limit--) {
+                const vote_t &vote = *ptr;
+                if (!predicate(vote)) {
+                    ptr++;
+                    continue;
+                }
+                const uint64_t foreign_id = vote.foreign_id;
+                if (tree) {
+                    tree->remove(vote);
                 }
+                if (weights) {
+                    weights->remove(vote);
+                }
+                charge(vote, false);
+                ptr = index.erase(ptr);
+                notify(foreign_id, voter, VOTE_REVOKED);
             }
-            votes.emplace(vote.voter, [&](auto &obj) {
-                obj = vote;
-                obj.id = votes.available_primary_key();
-            });
+            return ptr != index.end() && ptr->voter == voter ? ptr->id : no_vote;
         }
 
-        void erase_all(uint64_t foreign_id) {
-            auto index = votes.template get_index<name("foreign")>();
-            auto ptr = index.lower_bound(foreign_id);
-            while (ptr != index.upper_bound(foreign_id)) {
-                uint64_t id = ptr->id;
-                ptr++;
-                votes.erase(votes.get(id));
+        // adds the vote moved from another contract as it is, no event is sent
+        void import(const vote_t &vote, eosio::name payer) {
+            eosio_assert(votes.find(vote.id) == votes.end(), "vote exists");
+            auto index = votes.template get_index<"voter"_n>();
+            for (auto ptr = index.lower_bound(uint128_t(vote.voter.value) << 64); ptr != index.end() && ptr->voter == vote.voter; ptr++) {
+                eosio_assert(ptr->foreign_id != vote.foreign_id, "the vote already exists");
+            }
+
+            auto vote_ptr = votes.emplace(payer, [&](vote_t &obj) {
+                obj = vote;
+            });
+            if (tree) {
+                tree->insert(*vote_ptr, payer);
+            }
+            if (weights) {
+                weights->insert(*vote_ptr, payer);
             }
+            charge(*vote_ptr, true, payer);
         }
 
         void erase(uint64_t foreign_id, const eosio::name &voter) {
-            auto index = votes.template get_index<name("foreign")>();
-            for (auto ptr = index.lower_bound(foreign_id); ptr != index.upper_bound(foreign_id); ptr++) {
-                if (ptr->voter == voter) {
-                    votes.erase(votes.get(ptr->id));
-                    break;
-                }
+            auto range = foreign_range(votes, foreign_id);
+            auto ptr = range.find_if([&](const vote_t &vote) {
+                return vote.voter == voter;
+            });
+            if (ptr == range.end()) {
+                return;
             }
+            range.erase(ptr, [&](const vote_t &vote) {
+                if (tree) {
+                    tree->remove(vote);
+                }
+                if (weights) {
+                    weights->remove(vote);
+                }
+                charge(vote, false);
+            });
+            notify(foreign_id, voter, VOTE_REVOKED);
         }
     };
 
@@ -178,8 +1168,11 @@ private:
     struct approve_module_t: protected voting_module_t<TableName> {
         using voting_module_t<TableName>::count_positive;
         using voting_module_t<TableName>::erase_all;
+        using voting_module_t<TableName>::revoke;
+        using voting_module_t<TableName>::import;
 
-        approve_module_t(const eosio::name& code, uint64_t scope): voting_module_t<TableName>::voting_module_t(code, scope) {}
+        approve_module_t(const eosio::name& code, uint64_t scope, eosio::symbol_code pool, usage_module_t *usage = nullptr)
+            : voting_module_t<TableName>::voting_module_t(code, scope, pool, nullptr, nullptr, usage) {}
 
         void approve(uint64_t foreign_id, const eosio::name &approver) {
             vote_t v {
@@ -197,6 +1190,7 @@ private:
     };
 
     typedef uint64_t tspec_id_t;
+    struct tspec_patch_view_t;
     struct tspec_data_t {
         string text;
         asset specification_cost;
@@ -211,42 +1205,108 @@ private:
             (development_cost)(development_eta) \
             (payments_count)(payments_interval));
 
-        void update(const tspec_data_t &that, bool limited) {
-            bool modified = false;
+        // the text is replaced through the text store, see tspec_app_t::text_hash
+        void update(const tspec_patch_view_t &that, bool limited) {
+            if (that.specification_cost) {
+                eosio_assert(!limited, "cost can't be modified");
+                specification_cost = *that.specification_cost;
+            }
 
-            if (!that.text.empty()) {
-                text = that.text;
-                modified = true;
+            if (that.specification_eta) {
+                specification_eta = *that.specification_eta;
             }
 
-            if (that.specification_cost.amount != 0) {
+            if (that.development_cost) {
                 eosio_assert(!limited, "cost can't be modified");
-                specification_cost = that.specification_cost;
-                modified = true;
+                development_cost = *that.development_cost;
             }
 
-            if (that.specification_eta != 0) {
-                specification_eta = that.specification_eta;
-                modified = true;
+            if (that.development_eta) {
+                development_eta = *that.development_eta;
             }
 
-            if (that.development_cost.amount != 0) {
-                eosio_assert(!limited, "cost can be modified");
-                development_cost = that.development_cost;
-                modified = true;
+            if (that.payments_count) {
+                eosio_assert(*that.payments_count > 0, "invalid payments count");
+                payments_count = *that.payments_count;
             }
 
-            if (that.development_eta != 0) {
-                development_eta = that.development_eta;
-                modified = true;
+            if (that.payments_interval) {
+                eosio_assert(*that.payments_interval > 0, "invalid payments interval");
+                payments_interval = *that.payments_interval;
             }
+        }
+    };
+    struct tspec_view_t {
+        text_view_t text;
+        asset specification_cost;
+        uint32_t specification_eta;
+        asset development_cost;
+        uint32_t development_eta;
+        uint16_t payments_count;
+        uint32_t payments_interval;
+
+        tspec_view_t() = default;
+        tspec_view_t(const tspec_data_t &that) : text(that.text),
+            specification_cost(that.specification_cost), specification_eta(that.specification_eta),
+            development_cost(that.development_cost), development_eta(that.development_eta),
+            payments_count(that.payments_count), payments_interval(that.payments_interval) {}
+
+        EOSLIB_SERIALIZE(tspec_view_t, (text) \
+            (specification_cost)(specification_eta) \
+            (development_cost)(development_eta) \
+            (payments_count)(payments_interval));
+
+        // the text is kept in the text store
+        tspec_data_t without_text() const {
+            return tspec_data_t{string(), specification_cost, specification_eta,
+                development_cost, development_eta, payments_count, payments_interval};
+        }
+    };
 
-            if (that.payments_count != 0) {
-                payments_count = that.payments_count;
-                modified = true;
+    // only the fields that are set are sent and modified
+    struct tspec_patch_t {
+        optional<string> text;
+        optional<asset> specification_cost;
+        optional<uint32_t> specification_eta;
+        optional<asset> development_cost;
+        optional<uint32_t> development_eta;
+        optional<uint16_t> payments_count;
+        optional<uint32_t> payments_interval;
+
+        EOSLIB_SERIALIZE(tspec_patch_t, (text) \
+            (specification_cost)(specification_eta) \
+            (development_cost)(development_eta) \
+            (payments_count)(payments_interval));
+    };
+    struct tspec_patch_view_t {
+        optional<text_view_t> text;
+        optional<asset> specification_cost;
+        optional<uint32_t> specification_eta;
+        optional<asset> development_cost;
+        optional<uint32_t> development_eta;
+        optional<uint16_t> payments_count;
+        optional<uint32_t> payments_interval;
+
+        tspec_patch_view_t() = default;
+        tspec_patch_view_t(const tspec_patch_t &that) :
+            specification_cost(that.specification_cost), specification_eta(that.specification_eta),
+            development_cost(that.development_cost), development_eta(that.development_eta),
+            payments_count(that.payments_count), payments_interval(that.payments_interval)
+        {
+            if (that.text) {
+                text = text_view_t(*that.text);
             }
+        }
+
+        EOSLIB_SERIALIZE(tspec_patch_view_t, (text) \
+            (specification_cost)(specification_eta) \
+            (development_cost)(development_eta) \
+            (payments_count)(payments_interval));
 
-            eosio_assert(modified, "nothing to modify");
+        bool empty() const {
+            return !text && !specification_cost && !specification_eta &&
+                !development_cost && !development_eta &&
+                !payments_count && !payments_interval;
         }
     };
 
@@ -254,13 +1314,15 @@ private:
         tspec_id_t id;
         tspec_id_t foreign_id;
         eosio::name author;
-        tspec_data_t data;
+        tspec_data_t data; // data.text is kept by the applications posted before the text store, the newer ones leave it empty
         block_timestamp created;
         block_timestamp modified;
+        binary_extension<checksum256> text_hash;
+        binary_extension<uint8_t> version;
 
-        EOSLIB_SERIALIZE(tspec_app_t, (id)(foreign_id)(author)(data)(created)(modified));
+        EOSLIB_SERIALIZE(tspec_app_t, (id)(foreign_id)(author)(data)(created)(modified)(text_hash)(version));
 
-        void modify(const tspec_data_t &that, bool limited = false) {
+        void modify(const tspec_patch_view_t &that, bool limited = false) {
             data.update(that, limited);
             modified = TIMESTAMP_NOW;
         }
@@ -273,31 +1335,32 @@ private:
 
     using proposal_id_t = uint64_t;
     struct [[eosio::table]] proposal_t {
-        enum state_t {
-            STATE_TSPEC_APP = 1,
-            STATE_TSPEC_CREATE,
-            STATE_WORK,
-            STATE_DELEGATES_REVIEW,
-            STATE_PAYMENT,
-            STATE_CLOSED
-        };
+        using state_t = proposal_rules::state_t;
+        static constexpr state_t STATE_TSPEC_APP = proposal_rules::STATE_TSPEC_APP;
+        static constexpr state_t STATE_TSPEC_CREATE = proposal_rules::STATE_TSPEC_CREATE;
+        static constexpr state_t STATE_WORK = proposal_rules::STATE_WORK;
+        static constexpr state_t STATE_DELEGATES_REVIEW = proposal_rules::STATE_DELEGATES_REVIEW;
+        static constexpr state_t STATE_PAYMENT = proposal_rules::STATE_PAYMENT;
+        static constexpr state_t STATE_CLOSED = proposal_rules::STATE_CLOSED;
 
         enum review_status_t {
             STATUS_REJECT = 0,
             STATUS_ACCEPT = 1
         };
 
-        enum type_t {
-            TYPE_1,
-            TYPE_2
-        };
+        using type_t = proposal_rules::type_t;
+        static constexpr type_t TYPE_1 = proposal_rules::TYPE_1;
+        static constexpr type_t TYPE_2 = proposal_rules::TYPE_2;
+
+        // tspec_id of the proposals closed without a chosen technical specification
+        static constexpr tspec_id_t NO_TSPEC = std::numeric_limits<tspec_id_t>::max();
 
         proposal_id_t id;
         eosio::name author;
         uint8_t type;
         uint8_t state;
         string title;
-        string description;
+        string description; // kept by the proposals posted before the text store, the newer ones leave it empty
         eosio::name fund_name;
         asset deposit;
         tspec_id_t tspec_id;
@@ -307,16 +1370,28 @@ private:
         block_timestamp payment_begining_time;
         block_timestamp created;
         block_timestamp modified;
+        binary_extension<checksum256> description_hash;
+        binary_extension<uint8_t> version;
 
         EOSLIB_SERIALIZE(proposal_t, (id)(author)(type)(state)(title)(description)\
             (fund_name)(deposit)(tspec_id)\
             (worker)(work_begining_time)(worker_payments_count)\
-            (payment_begining_time)(created)(modified));
+            (payment_begining_time)(created)(modified)(description_hash)(version));
 
         uint64_t primary_key() const { return id; }
+        uint64_t by_created() const { return created.slot; }
+        // proposals in the state in the order of id
+        uint128_t by_state() const { return (uint128_t(state) << 64) | id; }
+        uint64_t by_author() const { return author.value; }
+        uint64_t by_worker() const { return worker.value; }
         void set_state(state_t new_state) { state = new_state; }
     };
-    multi_index<"proposals"_n, proposal_t> _proposals;
+    // the rows stored before the state, author and worker indexes have no entries in them until migrate stores them again
+    multi_index<"proposals"_n, proposal_t,
+        indexed_by<"created"_n, const_mem_fun<proposal_t, uint64_t, &proposal_t::by_created>>,
+        indexed_by<"state"_n, const_mem_fun<proposal_t, uint128_t, &proposal_t::by_state>>,
+        indexed_by<"author"_n, const_mem_fun<proposal_t, uint64_t, &proposal_t::by_author>>,
+        indexed_by<"worker"_n, const_mem_fun<proposal_t, uint64_t, &proposal_t::by_worker>>> _proposals;
 
     struct [[eosio::table("state")]] state_t {
         eosio::symbol token_symbol;
@@ -324,6 +1399,65 @@ private:
     };
     singleton<"state"_n, state_t> _state;
 
+    // running totals of the fund movements: the contract holds funded - paid tokens, deposited of them
+    // are locked in the proposals and the rest is in the funds. The pools funded before the totals were kept
+    // are counted in by synctotals, until then no fund movement is accepted
+    struct [[eosio::table("totals")]] totals_t {
+        asset funded;
+        asset deposited;
+        asset paid;
+        uint64_t movements;
+
+        EOSLIB_SERIALIZE(totals_t, (funded)(deposited)(paid)(movements));
+    };
+    singleton<"totals"_n, totals_t> _totals;
+
+    enum movement_kind_t : uint8_t {
+        MOVEMENT_FUND = 1, // a transfer credited to the fund
+        MOVEMENT_LOCK,     // the fund quantity deposited to the proposal
+        MOVEMENT_UNLOCK,   // the proposal deposit refunded to the fund
+        MOVEMENT_PAYOUT    // a reward paid from the proposal deposit
+    };
+
+    static constexpr uint64_t journal_capacity = 4096;
+    static constexpr uint64_t journal_checkpoint_interval = 64;
+
+    // the last journal_capacity fund movements, every journal_checkpoint_interval-th movement is a checkpoint
+    // carrying the totals after it, so an audit replays the movements from a checkpoint instead of the whole history
+    struct [[eosio::table]] movement_t {
+        uint64_t id;
+        uint8_t kind;
+        eosio::name fund_name;
+        proposal_id_t proposal_id; // 0 for MOVEMENT_FUND
+        asset quantity;
+        block_timestamp created;
+        optional<totals_t> checkpoint;
+
+        EOSLIB_SERIALIZE(movement_t, (id)(kind)(fund_name)(proposal_id)(quantity)(created)(checkpoint));
+
+        uint64_t primary_key() const { return id; }
+    };
+    multi_index<"journal"_n, movement_t> _journal;
+
+    enum totals_sync_stage_t : uint8_t {
+        SYNC_FUNDS,
+        SYNC_PROPOSALS
+    };
+
+    // the progress of synctotals: the table and the primary key to go on from and the sums counted so far.
+    // The paid tokens and the journal position aren't kept by the other tables, so they are carried over from the totals
+    struct [[eosio::table("totalssync")]] totals_sync_t {
+        uint8_t stage;
+        uint64_t next_id;
+        asset funds;
+        asset deposited;
+        asset paid;
+        uint64_t movements;
+
+        EOSLIB_SERIALIZE(totals_sync_t, (stage)(next_id)(funds)(deposited)(paid)(movements));
+    };
+    singleton<"totalssync"_n, totals_sync_t> _totals_sync;
+
     struct [[eosio::table]] fund_t {
         eosio::name owner;
         asset quantity;
@@ -334,17 +1468,149 @@ private:
     };
     multi_index<"funds"_n, fund_t> _funds;
 
+    // memo of a transfer to the contract, parsed in place:
+    //   "fund:<name>" credits the fund of the sender, <name> has to be the sender,
+    //   "<name>" credits the fund <name>, as the transfers did before the prefixes,
+    //   "proposal:<id>" credits the sender's fund and deposits the transfer to the proposal <id>
+    struct transfer_memo_t {
+        eosio::name fund_name;
+        optional<proposal_id_t> proposal_id;
+
+        // returns nothing if the memo isn't addressed to a fund
+        static optional<transfer_memo_t> parse(std::string_view memo, eosio::name sender) {
+            constexpr std::string_view fund_prefix = "fund:";
+            constexpr std::string_view proposal_prefix = "proposal:";
+
+            if (memo.substr(0, fund_prefix.size()) == fund_prefix) {
+                const eosio::name fund_name(memo.substr(fund_prefix.size()));
+                eosio_assert(fund_name == sender, "the memo can name only the fund of the sender");
+                return transfer_memo_t{fund_name, {}};
+            }
+            if (memo.substr(0, proposal_prefix.size()) == proposal_prefix) {
+                return transfer_memo_t{sender, parse_id(memo.substr(proposal_prefix.size()))};
+            }
+            if (memo.size() <= 13) {
+                return transfer_memo_t{eosio::name(memo), {}};
+            }
+            return {};
+        }
+
+        static proposal_id_t parse_id(std::string_view text) {
+            eosio_assert(!text.empty(), "invalid proposal id in the memo");
+            proposal_id_t id = 0;
+            for (char c : text) {
+                const uint64_t digit = c - '0';
+                eosio_assert(c >= '0' && c <= '9' && id <= (std::numeric_limits<proposal_id_t>::max() - digit) / 10,
+                             "invalid proposal id in the memo");
+                id = id * 10 + digit;
+            }
+            return id;
+        }
+    };
+
+    // discussion comments are kept readable from the tables, statuses, reviews and approve
+    // comments aren't read by the contract and are stored as hashes only
     comments_module_t<"proposalsc"_n> _proposal_comments;
+    vote_tree_module_t _proposal_vote_tree;
+    vote_weights_module_t _proposal_vote_weights;
     voting_module_t<"proposalsv"_n> _proposal_votes;
     approve_module_t<"proposalstsv"_n> _proposal_tspec_votes;
-    comments_module_t<"tspecappc"_n> _proposal_tspec_comments;
-    comments_module_t<"statusc"_n> _proposal_status_comments;
-    comments_module_t<"reviewc"_n> _proposal_review_comments;
+    comments_module_t<"tspecappc"_n, STORE_HASH> _proposal_tspec_comments;
+    comments_module_t<"statusc"_n, STORE_HASH> _proposal_status_comments;
+    comments_module_t<"reviewc"_n, STORE_HASH> _proposal_review_comments;
     voting_module_t<"proposalsrv"_n> _proposal_review_votes;
 
+    // everything a proposal card shows besides the proposal row, kept up to date by the actions,
+    // so a list view reads one row per proposal instead of counting the votes and comments
+    struct [[eosio::table]] proposal_summary_t {
+        proposal_id_t id;
+        uint8_t state;
+        tspec_id_t tspec_id;
+        uint32_t tspecs_count;
+        uint32_t positive_votes;
+        uint32_t negative_votes;
+        uint32_t positive_reviews;
+        uint32_t negative_reviews;
+        uint32_t comments_count;
+        uint32_t tspec_comments_count;
+        uint32_t status_comments_count;
+
+        EOSLIB_SERIALIZE(proposal_summary_t, (id)(state)(tspec_id)(tspecs_count)\
+            (positive_votes)(negative_votes)(positive_reviews)(negative_reviews)\
+            (comments_count)(tspec_comments_count)(status_comments_count));
+
+        uint64_t primary_key() const { return id; }
+
+        static void count_vote(uint32_t &positive, uint32_t &negative, vote_event_t previous, vote_event_t vote) {
+            positive += (vote == VOTE_POSITIVE) - (previous == VOTE_POSITIVE);
+            negative += (vote == VOTE_NEGATIVE) - (previous == VOTE_NEGATIVE);
+        }
+    };
+    multi_index<"propsummary"_n, proposal_summary_t> _proposal_summaries;
+
+    // the time a proposal may stay in its state, the proposals in the states that don't expire have no deadline
+    struct [[eosio::table]] deadline_t {
+        proposal_id_t id;
+        uint8_t state;
+        uint32_t deadline; // seconds since epoch
+
+        EOSLIB_SERIALIZE(deadline_t, (id)(state)(deadline));
+
+        uint64_t primary_key() const { return id; }
+        uint64_t by_deadline() const { return deadline; }
+    };
+    multi_index<"deadlines"_n, deadline_t,
+        indexed_by<"deadline"_n, const_mem_fun<deadline_t, uint64_t, &deadline_t::by_deadline>>> _deadlines;
+
+    // where revokevotes stopped in the votes of an account, the row is erased once all its votes are visited
+    struct [[eosio::table]] revocation_t {
+        eosio::name voter;
+        uint64_t tspec_vote_id;  // the next vote to visit in the proposalstsv
+        uint64_t review_vote_id; // the next vote to visit in the proposalsrv
+
+        EOSLIB_SERIALIZE(revocation_t, (voter)(tspec_vote_id)(review_vote_id));
+
+        uint64_t primary_key() const { return voter.value; }
+    };
+    multi_index<"revocations"_n, revocation_t> _revocations;
+
+    // the number of the rows moved by import so far, a batch sent again skips the rows imported before
+    struct [[eosio::table("importstate")]] import_state_t {
+        uint64_t rows;
+
+        EOSLIB_SERIALIZE(import_state_t, (rows));
+    };
+    singleton<"importstate"_n, import_state_t> _import_state;
+
+    enum migration_table_t : uint8_t {
+        MIGRATE_PROPOSALS,
+        MIGRATE_TSPECS,
+        MIGRATE_PROPOSAL_COMMENTS,
+        MIGRATE_TSPEC_COMMENTS,
+        MIGRATE_STATUS_COMMENTS,
+        MIGRATE_REVIEW_COMMENTS,
+        MIGRATE_DONE
+    };
+
+    // the progress of migrate: the layout the rows are upgraded to, the table and the primary key to go on from
+    struct [[eosio::table("migration")]] migration_t {
+        uint8_t version;
+        uint8_t table;
+        uint64_t next_id;
+
+        EOSLIB_SERIALIZE(migration_t, (version)(table)(next_id));
+    };
+    singleton<"migration"_n, migration_t> _migration;
+
 protected:
+    void require_pool()
+    {
+        eosio_assert(_state.exists(), "workers pool has not been created for the specified app domain");
+    }
+
     auto get_state()
     {
+        require_pool();
         return _state.get();
     }
 
@@ -360,6 +1626,31 @@ protected:
         //TODO: eosio_assert(golos.ctrl::is_witness(account, _app), "app domain delegate authority is required to do this action");
     }
 
+    // the usage of a proposal or an application with its text, see usage_module_t
+    int64_t usage_of(const proposal_t &proposal) const {
+        return usage_module_t::row_bytes(proposal, 4, _texts.size(proposal.description_hash.value_or()));
+    }
+
+    int64_t usage_of(const tspec_app_t &tspec_app) const {
+        return usage_module_t::row_bytes(tspec_app, 1, _texts.size(tspec_app.text_hash.value_or()));
+    }
+
+    void charge(const proposal_t &proposal, bool add, eosio::name payer) {
+        _usage.charge(proposal.author, proposal.id, add ? usage_of(proposal) : -usage_of(proposal), add ? 1 : -1, payer);
+    }
+
+    void charge(const proposal_t &proposal, bool add) {
+        charge(proposal, add, proposal.author);
+    }
+
+    void charge(const tspec_app_t &tspec_app, bool add, eosio::name payer) {
+        _usage.charge(tspec_app.author, tspec_app.foreign_id, add ? usage_of(tspec_app) : -usage_of(tspec_app), add ? 1 : -1, payer);
+    }
+
+    void charge(const tspec_app_t &tspec_app, bool add) {
+        charge(tspec_app, add, tspec_app.author);
+    }
+
     const auto get_proposal(proposal_id_t proposal_id)
     {
         auto proposal = _proposals.find(proposal_id);
@@ -367,6 +1658,105 @@ protected:
         return proposal;
     }
 
+    // checks the proposal against the rule of the action, the rule is resolved at compile time
+    template <proposal_rules::action_t Action>
+    static void require_rule(const proposal_t &proposal) {
+        static_assert(Action < proposal_rules::ACTIONS_COUNT, "unknown action");
+        constexpr proposal_rules::rule_t rule = proposal_rules::rules[Action];
+
+        eosio_assert_code(rule.allows_state(proposal.state), proposal_rules::invalid_state_code(Action));
+        if constexpr (rule.types != proposal_rules::ANY_TYPE) {
+            eosio_assert_code(rule.allows_type(proposal.type), proposal_rules::unsupported_type_code(Action));
+        }
+    }
+
+    void notify(const proposal_t &proposal) {
+        send_event(_self, "eventpropos"_n, _pool, proposal.id, proposal.state, proposal.tspec_id, proposal.deposit);
+        update_summary(proposal.id, [&](proposal_summary_t &obj) {
+            obj.state = proposal.state;
+            obj.tspec_id = proposal.tspec_id;
+        });
+    }
+
+    // counts the summary from the tables, used when the summary is created or resynchronized
+    proposal_summary_t count_summary(const proposal_t &proposal) const {
+        proposal_summary_t summary{};
+        summary.id = proposal.id;
+        summary.state = proposal.state;
+        summary.tspec_id = proposal.tspec_id;
+
+        for (const tspec_app_t &tspec_app : foreign_range(_proposal_tspecs, proposal.id)) {
+            summary.tspecs_count++;
+            summary.tspec_comments_count += _proposal_tspec_comments.count(tspec_app.id);
+        }
+
+        summary.positive_votes = _proposal_votes.count_positive(proposal.id);
+        summary.negative_votes = _proposal_votes.count_negative(proposal.id);
+        summary.positive_reviews = _proposal_review_votes.count_positive(proposal.id);
+        summary.negative_reviews = _proposal_review_votes.count_negative(proposal.id);
+        summary.comments_count = _proposal_comments.count(proposal.id);
+        summary.status_comments_count = _proposal_status_comments.count(proposal.id);
+        return summary;
+    }
+
+    void add_summary(const proposal_t &proposal, eosio::name payer) {
+        _proposal_summaries.emplace(payer, [&](proposal_summary_t &obj) {
+            obj = count_summary(proposal);
+        });
+    }
+
+    // the proposals created before the summaries were introduced have no summary until syncsummary is called
+    template <typename Modifier>
+    void update_summary(proposal_id_t proposal_id, Modifier &&modifier) {
+        auto summary_ptr = _proposal_summaries.find(proposal_id);
+        if (summary_ptr != _proposal_summaries.end()) {
+            _proposal_summaries.modify(summary_ptr, name(), modifier);
+        }
+    }
+
+    void notify(const fund_t &fund) {
+        send_event(_self, "eventfund"_n, _pool, fund.owner, fund.quantity);
+    }
+
+    void record(movement_kind_t kind, eosio::name fund_name, proposal_id_t proposal_id, const asset &quantity) {
+        eosio_assert(_totals.exists(), "the totals have to be counted by synctotals");
+        totals_t totals = _totals.get();
+        switch (kind) {
+        case MOVEMENT_FUND:
+            totals.funded += quantity;
+            break;
+        case MOVEMENT_LOCK:
+            totals.deposited += quantity;
+            break;
+        case MOVEMENT_UNLOCK:
+            eosio_assert(quantity <= totals.deposited, "the deposit exceeds the deposited total");
+            totals.deposited -= quantity;
+            break;
+        case MOVEMENT_PAYOUT:
+            eosio_assert(quantity <= totals.deposited, "the deposit exceeds the deposited total");
+            totals.deposited -= quantity;
+            totals.paid += quantity;
+            break;
+        }
+
+        const uint64_t id = totals.movements++;
+        _journal.emplace(_self, [&](movement_t &obj) {
+            obj.id = id;
+            obj.kind = kind;
+            obj.fund_name = fund_name;
+            obj.proposal_id = proposal_id;
+            obj.quantity = quantity;
+            obj.created = TIMESTAMP_NOW;
+            if (id % journal_checkpoint_interval == 0) {
+                obj.checkpoint = totals;
+            }
+        });
+        if (id >= journal_capacity) {
+            _journal.erase(_journal.get(id - journal_capacity));
+        }
+        _totals.set(totals, _self);
+    }
+
     void deposit(proposal_t &proposal) {
         const tspec_data_t &tspec = _proposal_tspecs.get(proposal.tspec_id).data;
         const asset budget = tspec.development_cost + tspec.specification_cost;
@@ -378,11 +1768,32 @@ protected:
         _funds.modify(fund, name(), [&](auto &obj) {
             obj.quantity -= budget;
         });
+        notify(fund);
+        record(MOVEMENT_LOCK, fund.owner, proposal.id, budget);
+    }
+
+    // moves the quantity from the fund to the proposal deposit
+    void lock_fund(const proposal_t &proposal, const fund_t &fund, const asset &quantity, eosio::name payer) {
+        eosio_assert(proposal.deposit.amount == 0, "fund is already deposited");
+        require_rule<proposal_rules::ACTION_SETFUND>(proposal);
+        eosio_assert(fund.quantity >= quantity, "insufficient funds");
+
+        _proposals.modify(proposal, payer, [&](auto &o) {
+            o.fund_name = fund.owner;
+            o.deposit = quantity;
+        });
+
+        _funds.modify(fund, payer, [&](auto &obj) {
+            obj.quantity -= quantity;
+        });
+
+        notify(proposal);
+        notify(fund);
+        record(MOVEMENT_LOCK, fund.owner, proposal.id, quantity);
     }
 
     void choose_proposal_tspec(proposal_t & proposal, const tspec_app_t &tspec_app)
     {
-        eosio_assert(proposal.type == proposal_t::TYPE_1, "invalid state for choose_proposal_tspec");
         proposal.tspec_id = tspec_app.id;
         proposal.set_state(proposal_t::STATE_TSPEC_CREATE);
 
@@ -400,6 +1811,7 @@ protected:
 
         LOG("paying % to %", tspec.specification_cost, ACCOUNT_NAME_CSTR(tspec_app.author));
         proposal.deposit -= tspec.specification_cost;
+        record(MOVEMENT_PAYOUT, proposal.fund_name, proposal.id, tspec.specification_cost);
 
         action(permission_level{_self, "active"_n},
                TOKEN_ACCOUNT,
@@ -410,48 +1822,371 @@ protected:
                 .send();
     }
 
-    void enable_worker_reward(proposal_t & proposal)
-    {
-        proposal.payment_begining_time = TIMESTAMP_NOW;
-        proposal.set_state(proposal_t::STATE_PAYMENT);
+    void enable_worker_reward(proposal_t & proposal)
+    {
+        proposal.payment_begining_time = TIMESTAMP_NOW;
+        proposal.set_state(proposal_t::STATE_PAYMENT);
+    }
+
+    void refund(proposal_t & proposal, eosio::name modifier)
+    {
+        eosio_assert(proposal.deposit.amount > 0, "no funds were deposited");
+
+        const auto &fund = _funds.get(proposal.fund_name.value);
+        LOG("% to % fund", proposal.deposit, ACCOUNT_NAME_CSTR(fund.owner));
+        _funds.modify(fund, modifier, [&](auto &obj) {
+            obj.quantity += proposal.deposit;
+        });
+        notify(fund);
+        record(MOVEMENT_UNLOCK, fund.owner, proposal.id, proposal.deposit);
+
+        proposal.deposit = ZERO_ASSET;
+    }
+
+    void close(proposal_t & proposal)
+    {
+        proposal.set_state(proposal_t::STATE_CLOSED);
+    }
+
+    // seconds the proposal may stay in its state before it is swept, 0 if the state doesn't expire
+    uint64_t get_timeout(const proposal_t &proposal) const {
+        switch (proposal.state) {
+        case proposal_t::STATE_TSPEC_APP:
+        case proposal_t::STATE_DELEGATES_REVIEW:
+            return voting_time_s;
+        case proposal_t::STATE_TSPEC_CREATE:
+            // the author of the selected application has to start the work
+            return uint64_t(_proposal_tspecs.get(proposal.tspec_id).data.specification_eta) + voting_time_s;
+        case proposal_t::STATE_WORK:
+            return uint64_t(_proposal_tspecs.get(proposal.tspec_id).data.development_eta) + voting_time_s;
+        default:
+            return 0;
+        }
+    }
+
+    // sets the deadline when the proposal enters a state that expires, a new tspec application restarts it
+    void update_deadline(const proposal_t &proposal, eosio::name payer, bool restart = false) {
+        auto deadline_ptr = _deadlines.find(proposal.id);
+        const uint64_t timeout = get_timeout(proposal);
+        if (timeout == 0) {
+            if (deadline_ptr != _deadlines.end()) {
+                _deadlines.erase(deadline_ptr);
+            }
+            return;
+        }
+
+        if (deadline_ptr != _deadlines.end() && deadline_ptr->state == proposal.state && !restart) {
+            return;
+        }
+
+        const uint32_t deadline = std::min<uint64_t>(now() + timeout, std::numeric_limits<uint32_t>::max());
+        if (deadline_ptr == _deadlines.end()) {
+            _deadlines.emplace(payer, [&](deadline_t &obj) {
+                obj.id = proposal.id;
+                obj.state = proposal.state;
+                obj.deadline = deadline;
+            });
+        } else {
+            _deadlines.modify(deadline_ptr, name(), [&](deadline_t &obj) {
+                obj.state = proposal.state;
+                obj.deadline = deadline;
+            });
+        }
+    }
+
+    using import_texts_t = std::map<checksum256, const string *>;
+
+    // refers to the text of an imported row, the text is taken from the batch unless it is already stored.
+    // Returns the size of the text
+    size_t import_text(const checksum256 &hash, const import_texts_t &texts) {
+        if (hash == checksum256()) {
+            return 0;
+        }
+
+        auto index = _texts.texts.get_index<"hash"_n>();
+        auto text_ptr = index.find(hash);
+        if (text_ptr != index.end()) {
+            index.modify(text_ptr, name(), [&](text_t &obj) {
+                obj.refs++;
+            });
+            return text_ptr->text.size();
+        }
+
+        auto batch_ptr = texts.find(hash);
+        eosio_assert(batch_ptr != texts.end(), "text has not been found");
+        _texts.add(hash, *batch_ptr->second);
+        return batch_ptr->second->size();
+    }
+
+    void import_proposal(const proposal_t &proposal, const import_texts_t &texts) {
+        eosio_assert(_proposals.find(proposal.id) == _proposals.end(), "proposal exists");
+        eosio_assert(proposal.type == proposal_t::TYPE_1 || proposal.type == proposal_t::TYPE_2, "invalid proposal type");
+        // the deposits are locked by setfund after the import, the tokens have to be in the funds first. setfund takes
+        // only the proposals waiting for the applications, the later states can't go on without a deposit
+        eosio_assert(proposal.state == proposal_t::STATE_CLOSED || (proposal.state == proposal_t::STATE_TSPEC_APP && proposal.type == proposal_t::TYPE_1),
+                     "only the proposals waiting for the applications or closed can be imported");
+        eosio_assert(proposal.deposit.amount == 0, "imported proposal can't hold a deposit");
+
+        import_text(proposal.description_hash.value_or(), texts);
+        const proposal_t &row = *_proposals.emplace(_self, [&](proposal_t &obj) {
+            obj = proposal;
+            obj.version.emplace(row_version);
+        });
+        add_summary(row, _self);
+        update_deadline(row, _self);
+        charge(row, true, _self);
+    }
+
+    void import_tspec(const tspec_app_t &tspec_app, const import_texts_t &texts, const eosio::symbol &token_symbol) {
+        eosio_assert(_proposal_tspecs.find(tspec_app.id) == _proposal_tspecs.end(), "technical specification application exists");
+        eosio_assert(_proposals.find(tspec_app.foreign_id) != _proposals.end(), "proposal has not been found");
+        eosio_assert(tspec_app.data.specification_cost.symbol == token_symbol, "invalid symbol for the specification cost");
+        eosio_assert(tspec_app.data.development_cost.symbol == token_symbol, "invalid symbol for the development cost");
+
+        // a text kept inline by the exporting contract is moved to the text store
+        checksum256 text_hash = tspec_app.text_hash.value_or();
+        if (!tspec_app.data.text.empty()) {
+            eosio_assert(text_hash == checksum256(), "technical specification application has both a text and a text hash");
+            text_hash = _texts.add(tspec_app.data.text);
+        } else {
+            import_text(text_hash, texts);
+        }
+        charge(*_proposal_tspecs.emplace(_self, [&](tspec_app_t &obj) {
+            obj = tspec_app;
+            obj.data.text.clear();
+            obj.text_hash.emplace(text_hash);
+            obj.version.emplace(row_version);
+        }), true, _self);
+        update_summary(tspec_app.foreign_id, [&](proposal_summary_t &obj) {
+            obj.tspecs_count++;
+        });
+    }
+
+    // returns the proposal the comment or the vote belongs to, through the application for the ones given to an application
+    proposal_id_t import_foreign_id(uint64_t foreign_id, bool by_proposal) {
+        if (by_proposal) {
+            eosio_assert(_proposals.find(foreign_id) != _proposals.end(), "proposal has not been found");
+            return foreign_id;
+        }
+        auto tspec_ptr = _proposal_tspecs.find(foreign_id);
+        eosio_assert(tspec_ptr != _proposal_tspecs.end(), "technical specification application has not been found");
+        return tspec_ptr->foreign_id;
+    }
+
+    // the comments storing only the hashes have no texts to import. The counter updates the summary of the proposal
+    // the row belongs to
+    template <typename Comments, typename Counter>
+    void import_comment(Comments &module, const comment_t &comment, const import_texts_t &texts, Counter &&counter) {
+        auto &comments = module.comments;
+        eosio_assert(comments.find(comment.id) == comments.end(), "comment exists");
+        const proposal_id_t proposal_id = import_foreign_id(comment.foreign_id, module.by_proposal);
+        if (Comments::keeps_text()) {
+            eosio_assert(import_text(comment.text_hash.value_or(), texts) == comment.text_size.value_or(), "comment text size mismatch");
+        }
+
+        module.charge(*comments.emplace(_self, [&](comment_t &obj) {
+            obj = comment;
+            obj.version.emplace(row_version);
+        }), true, _self);
+        update_summary(proposal_id, counter);
+    }
+
+    template <typename Votes, typename Counter>
+    void import_vote(Votes &module, const vote_t &vote, bool by_proposal, Counter &&counter) {
+        const proposal_id_t proposal_id = import_foreign_id(vote.foreign_id, by_proposal);
+        module.import(vote, _self);
+        update_summary(proposal_id, counter);
+    }
+
+    // the payer for a row modified by an action that anyone can call: the row stays billed to its payer unless it has been
+    // stored without the version, such a row grows by it and the caller can't bill the payer, so the contract takes it over
+    template <typename T>
+    eosio::name keep_payer(const T &row) const {
+        return row.version.has_value() ? name() : _self;
+    }
+
+    // rewrites the rows of the table from the cursor on in the current layout, every row gone through counts to the limit.
+    // A row is upgraded from its version to the next one in turn by upgrade(row, version). The rows grow, so they
+    // and the texts moved out of them are billed to the contract. Returns false if the limit has been reached
+    // before the end of the table
+    template <typename Table, typename Upgrade>
+    bool migrate_rows(Table &table, migration_t &cursor, uint16_t &count, uint16_t limit, Upgrade &&upgrade) {
+        for (auto ptr = table.lower_bound(cursor.next_id); ptr != table.end(); ptr++) {
+            if (count == limit) {
+                cursor.next_id = ptr->id;
+                return false;
+            }
+            count++;
+            if (ptr->version.value_or() < row_version) {
+                table.modify(ptr, _self, [&](auto &obj) {
+                    for (uint8_t version = obj.version.value_or(); version < row_version; version++) {
+                        upgrade(obj, version);
+                    }
+                    obj.version.emplace(row_version);
+                });
+            }
+        }
+        return true;
+    }
+
+    // the version 1 keeps the texts in the text store, the rows posted before it keep them inline
+    void upgrade_row(proposal_t &proposal, uint8_t version) {
+        if (version == 0 && !proposal.description_hash.has_value()) {
+            proposal.description_hash.emplace(_texts.add(proposal.description));
+            proposal.description.clear();
+        }
+    }
+
+    void upgrade_row(tspec_app_t &tspec_app, uint8_t version) {
+        if (version == 0 && !tspec_app.text_hash.has_value()) {
+            tspec_app.text_hash.emplace(_texts.add(tspec_app.data.text));
+            tspec_app.data.text.clear();
+        }
+    }
+
+    // a proposal stored before the state, author and worker indexes has no entries in them, so a change of its state
+    // or worker can't update them. Such a proposal is stored again rather than modified, the new row gets the entries
+    bool migrate_proposals(migration_t &cursor, uint16_t &count, uint16_t limit) {
+        for (auto ptr = _proposals.lower_bound(cursor.next_id); ptr != _proposals.end(); ) {
+            if (count == limit) {
+                cursor.next_id = ptr->id;
+                return false;
+            }
+            count++;
+            if (ptr->version.value_or() >= row_version) {
+                ptr++;
+                continue;
+            }
+            proposal_t proposal = *ptr;
+            for (uint8_t version = proposal.version.value_or(); version < row_version; version++) {
+                upgrade_row(proposal, version);
+            }
+            proposal.version.emplace(row_version);
+            ptr = _proposals.erase(ptr);
+            _proposals.emplace(_self, [&](proposal_t &obj) {
+                obj = proposal;
+            });
+        }
+        return true;
+    }
+
+    template <typename Comments>
+    bool migrate_comments(Comments &module, migration_t &cursor, uint16_t &count, uint16_t limit) {
+        return migrate_rows(module.comments, cursor, count, limit, [&](comment_t &comment, uint8_t version) {
+            if (version == 0) {
+                module.upgrade(comment);
+            }
+        });
+    }
+
+    // erases the votes and comments of the application and releases its text, the row itself is left to the caller.
+    // Returns the number of the erased comments
+    size_t release_tspec(const tspec_app_t &tspec_app) {
+        _proposal_tspec_votes.erase_all(tspec_app.id);
+        const size_t comments_count = _proposal_tspec_comments.erase_all(tspec_app.id);
+        charge(tspec_app, false);
+        _texts.release(tspec_app.text_hash.value_or());
+        return comments_count;
     }
 
-    void refund(proposal_t & proposal, eosio::name modifier)
-    {
-        eosio_assert(proposal.deposit.amount > 0, "no funds were deposited");
+    // returns the number of the erased comments of the application
+    size_t del_tspec(const tspec_app_t &tspec_app) {
+        const size_t comments_count = release_tspec(tspec_app);
+        _proposal_tspecs.erase(tspec_app);
+        return comments_count;
+    }
 
-        const auto &fund = _funds.get(proposal.fund_name.value);
-        LOG("% to % fund", proposal.deposit, ACCOUNT_NAME_CSTR(fund.owner));
-        _funds.modify(fund, modifier, [&](auto &obj) {
-            obj.quantity += proposal.deposit;
+    // erases at most `limit` rows of the applications that lost the selection, the votes and comments of an application
+    // go before its row, so a reclaim cut by the limit is resumed by the next call. The erased rows are reimbursed
+    // to their payers. Returns the number of the erased rows
+    size_t reclaim_tspecs(const proposal_t &proposal, size_t limit) {
+        auto tspecs = foreign_range(_proposal_tspecs, proposal.id);
+        size_t erased = 0;
+        size_t tspecs_count = 0;
+        size_t comments_count = 0;
+
+        for (auto tspec_ptr = tspecs.begin(); tspec_ptr != tspecs.end() && erased < limit; ) {
+            const tspec_id_t tspec_id = tspec_ptr->id;
+            if (tspec_id == proposal.tspec_id) {
+                tspec_ptr++;
+                continue;
+            }
+
+            erased += _proposal_tspec_votes.erase_all(tspec_id, limit - erased);
+            const size_t comments = _proposal_tspec_comments.erase_all(tspec_id, limit - erased);
+            erased += comments;
+            comments_count += comments;
+            if (erased == limit) {
+                break;
+            }
+
+            tspec_ptr = tspecs.erase(tspec_ptr, [&](const tspec_app_t &tspec_app) {
+                charge(tspec_app, false);
+                _texts.release(tspec_app.text_hash.value_or());
+            });
+            erased++;
+            tspecs_count++;
+        }
+
+        LOG("proposal_id: %, erased % rows of % applications", proposal.id, erased, tspecs_count);
+        update_summary(proposal.id, [&](proposal_summary_t &obj) {
+            obj.tspecs_count -= tspecs_count;
+            obj.tspec_comments_count -= comments_count;
         });
+        return erased;
+    }
 
-        proposal.deposit = ZERO_ASSET;
+    worker(eosio::name receiver, eosio::name code, eosio::datastream<const char *>& ds, eosio::symbol_code pool, uint64_t scope)
+      : contract(receiver, code, ds),
+        _pool(pool),
+        _texts(_self, scope),
+        _usage(_self, scope),
+        _state(_self, scope),
+        _totals(_self, scope),
+        _journal(_self, scope),
+        _totals_sync(_self, scope),
+        _proposals(_self, scope),
+        _funds(_self, scope),
+        _proposal_comments(_self, scope, _texts, &_usage),
+        _proposal_vote_tree(_self, scope),
+        _proposal_vote_weights(_self, scope),
+        _proposal_votes(_self, scope, pool, &_proposal_vote_tree, &_proposal_vote_weights, &_usage),
+        _proposal_status_comments(_self, scope, _texts, &_usage),
+        _proposal_review_comments(_self, scope, _texts, &_usage),
+        _proposal_review_votes(_self, scope, pool, nullptr, nullptr, &_usage),
+        _proposal_summaries(_self, scope),
+        _deadlines(_self, scope),
+        _revocations(_self, scope),
+        _import_state(_self, scope),
+        _migration(_self, scope),
+        _proposal_tspecs(_self, scope),
+        // the approve comments refer to the applications, they are charged to the delegates only
+        _proposal_tspec_comments(_self, scope, _texts, &_usage, false),
+        _proposal_tspec_votes(_self, scope, pool, &_usage) {}
+
+public:
+    worker(eosio::name receiver, eosio::name code, eosio::datastream<const char *>& ds, eosio::symbol_code pool)
+      : worker(receiver, code, ds, pool, pool_scope(receiver, pool)) {}
+
+    // the pool created before the pools were scoped keeps its tables in the contract scope
+    static uint64_t pool_scope(eosio::name self, eosio::symbol_code pool) {
+        singleton<"state"_n, state_t> legacy_state(self, self.value);
+        return legacy_state.exists() && legacy_state.get().token_symbol.code() == pool ? self.value : pool.raw();
     }
 
-    void close(proposal_t & proposal)
-    {
-        proposal.set_state(proposal_t::STATE_CLOSED);
+    // the pool of an action is its first argument, the pool of a transfer is the token transferred
+    template <typename... Args>
+    static eosio::symbol_code pool_of(const std::tuple<eosio::symbol_code, Args...> &args) {
+        return std::get<0>(args);
     }
 
-    void del_tspec(const tspec_app_t &tspec_app) {
-        _proposal_tspec_votes.erase_all(tspec_app.id);
-        _proposal_tspec_comments.erase_all(tspec_app.id);
-        _proposal_tspecs.erase(tspec_app);
+    static eosio::symbol_code pool_of(const std::tuple<eosio::symbol> &args) {
+        return std::get<0>(args).code();
+    }
+
+    static eosio::symbol_code pool_of(const std::tuple<eosio::name, eosio::name, asset, text_view_t> &args) {
+        return std::get<2>(args).symbol.code();
     }
-public:
-    worker(eosio::name receiver, eosio::name code, eosio::datastream<const char *>& ds) : contract(receiver, code, ds),
-        _state(_self, _self.value),
-        _proposals(_self, _self.value),
-        _funds(_self, _self.value),
-        _proposal_comments(_self, _self.value),
-        _proposal_votes(_self, _self.value),
-        _proposal_status_comments(_self, _self.value),
-        _proposal_review_comments(_self, _self.value),
-        _proposal_review_votes(_self, _self.value),
-        _proposal_tspecs(_self, _self.value),
-        _proposal_tspec_comments(_self, _self.value),
-        _proposal_tspec_votes(_self, _self.value) {}
 
     /**
    * @brief createpool creates workers pool in the application domain
@@ -466,39 +2201,53 @@ public:
 
         state_t state{.token_symbol = token_symbol};
         _state.set(state, _self);
+        _totals.set(totals_t{ZERO_ASSET, ZERO_ASSET, ZERO_ASSET, 0}, _self);
         LOG("created");
     }
 
     /**
    * @brief addpropos publishs a new proposal
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id a proposal ID
    * @param author author of the new proposal
    * @param title proposal title
    * @param description proposal description
    */
     [[eosio::action]]
-    void addpropos(proposal_id_t proposal_id, const eosio::name& author, const string& title, const string& description) {
+    void addpropos(eosio::symbol_code pool, proposal_id_t proposal_id, const eosio::name& author, const string& title, const string& description) {
+        addpropos_view(pool, proposal_id, author, title, description);
+    }
+
+    // addpropos with the texts referring to the action data, dispatched by apply()
+    void addpropos_view(eosio::symbol_code pool, proposal_id_t proposal_id, const eosio::name& author, const text_view_t& title, const text_view_t& description) {
         require_app_member(author);
+        require_pool();
 
-        LOG("adding propos % \"%\" by %", proposal_id, title.c_str(), ACCOUNT_NAME_CSTR(author));
+        LOG("adding propos % by %", proposal_id, ACCOUNT_NAME_CSTR(author));
 
         _proposals.emplace(author, [&](auto &o) {
             o.id = proposal_id;
             o.type = proposal_t::TYPE_1;
             o.author = author;
-            o.title = title;
-            o.description = description;
+            o.title.assign(title.data, title.size);
+            o.description_hash.emplace(_texts.add(description));
             o.fund_name = _self;
 
             o.state = (uint8_t)proposal_t::STATE_TSPEC_APP;
             o.created = TIMESTAMP_NOW;
             o.modified = TIMESTAMP_UNDEFINED;
+            o.version.emplace(row_version);
         });
+        charge(_proposals.get(proposal_id), true);
+        notify(_proposals.get(proposal_id));
+        add_summary(_proposals.get(proposal_id), author);
+        update_deadline(_proposals.get(proposal_id), author);
         LOG("added % % % %", ACCOUNT_NAME_CSTR(_self), ACCOUNT_NAME_CSTR(_code), _proposals.get(proposal_id).id);
     }
 
     /**
    * @brief addpropos2 publishs a new proposal for the done work
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param author author of the proposal
    * @param title proposal title
@@ -507,7 +2256,7 @@ public:
    * @param worker the party that did work
    */
     [[eosio::action]]
-    void addpropos2(proposal_id_t proposal_id,
+    void addpropos2(eosio::symbol_code pool, proposal_id_t proposal_id,
                const eosio::name &author,
                const eosio::name &worker,
                const string &title,
@@ -515,10 +2264,24 @@ public:
                const tspec_data_t &tspec,
                const comment_id_t comment_id,
                const comment_data_t &comment)
+    {
+        addpropos2_view(pool, proposal_id, author, worker, title, description, tspec, comment_id, comment);
+    }
+
+    // addpropos2 with the texts referring to the action data, dispatched by apply()
+    void addpropos2_view(eosio::symbol_code pool, proposal_id_t proposal_id,
+               const eosio::name &author,
+               const eosio::name &worker,
+               const text_view_t &title,
+               const text_view_t &description,
+               const tspec_view_t &tspec,
+               const comment_id_t comment_id,
+               const comment_view_t &comment)
     {
         require_app_member(author);
+        require_pool();
 
-        LOG("adding propos % \"%\" by %, worker: %", proposal_id, title.c_str(), ACCOUNT_NAME_CSTR(author), ACCOUNT_NAME_CSTR(worker));
+        LOG("adding propos % by %, worker: %", proposal_id, ACCOUNT_NAME_CSTR(author), ACCOUNT_NAME_CSTR(worker));
 
         tspec_id_t tspec_id = _proposal_tspecs.available_primary_key();
 
@@ -526,8 +2289,8 @@ public:
             o.id = proposal_id;
             o.type = proposal_t::TYPE_2;
             o.author = author;
-            o.title = title;
-            o.description = description;
+            o.title.assign(title.data, title.size);
+            o.description_hash.emplace(_texts.add(description));
             o.fund_name = _self;
             o.tspec_id = tspec_id;
             o.worker = worker;
@@ -536,93 +2299,90 @@ public:
 
             o.created = TIMESTAMP_NOW;
             o.modified = TIMESTAMP_UNDEFINED;
+            o.version.emplace(row_version);
 
            o.set_state(proposal_t::STATE_DELEGATES_REVIEW);
         });
+        charge(_proposals.get(proposal_id), true);
+        notify(_proposals.get(proposal_id));
 
         _proposal_tspecs.emplace(author, [&](tspec_app_t &obj) {
             obj.id = tspec_id;
             obj.foreign_id = proposal_id;
             obj.author = author;
-            obj.data = tspec;
+            obj.data = tspec.without_text();
+            obj.text_hash.emplace(_texts.add(tspec.text));
             obj.created = TIMESTAMP_NOW;
             obj.modified = TIMESTAMP_UNDEFINED;
+            obj.version.emplace(row_version);
         });
+        charge(_proposal_tspecs.get(tspec_id), true);
 
         _proposal_status_comments.add(comment_id, proposal_id, author, comment);
+        add_summary(_proposals.get(proposal_id), author);
+        update_deadline(_proposals.get(proposal_id), author);
     }
 
     /**
    * @brief setfund sets a proposal fund
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param fund_name the name of the fund: application domain fund (applicatoin domain name) or sponsored fund (account name)
    * @param quantity amount of the tokens that will be deposited
    */
     [[eosio::action]]
-    void setfund(proposal_id_t proposal_id, eosio::name fund_name, asset quantity) {
+    void setfund(eosio::symbol_code pool, proposal_id_t proposal_id, eosio::name fund_name, asset quantity) {
         auto proposal_ptr = _proposals.find(proposal_id);
         eosio_assert(proposal_ptr != _proposals.end(), "proposal has not been found");
         require_app_member(fund_name);
         eosio_assert(get_state().token_symbol == quantity.symbol, "invalid symbol for setfund");
-        eosio_assert(proposal_ptr->deposit.amount == 0, "fund is already deposited");
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_TSPEC_APP, "invalid state for setfund");
-
-        const auto &fund = _funds.get(fund_name.value);
-        eosio_assert(fund.quantity >= quantity, "insufficient funds");
-
-        _proposals.modify(proposal_ptr, fund_name, [&](auto &o) {
-            o.fund_name = fund_name;
-            o.deposit = quantity;
-        });
 
-        _funds.modify(fund, fund_name, [&](auto &obj) {
-            obj.quantity -= quantity;
-        });
+        lock_fund(*proposal_ptr, _funds.get(fund_name.value), quantity, fund_name);
     }
 
     /**
    * @brief editpropos modifies proposal
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id ID of the modified proposal
-   * @param title new title, live empty if no changes are needed
-   * @param description a new description, live empty if no changes are required
+   * @param title new title, live null if no changes are needed
+   * @param description a new description, live null if no changes are required
    */
     [[eosio::action]]
-    void editpropos(proposal_id_t proposal_id, string title, string description)
+    void editpropos(eosio::symbol_code pool, proposal_id_t proposal_id, const optional<string> &title, const optional<string> &description)
     {
         auto proposal_ptr = get_proposal(proposal_id);
         require_app_member(proposal_ptr->author);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_TSPEC_APP, "invalid state for editpropos");
-        eosio_assert(!(description.empty() && title.empty()), "invalid arguments");
+        require_rule<proposal_rules::ACTION_EDITPROPOS>(*proposal_ptr);
+        eosio_assert(title || description, "invalid arguments");
 
+        charge(*proposal_ptr, false);
         _proposals.modify(proposal_ptr, proposal_ptr->author, [&](auto &o) {
-            if (!description.empty()) {
-                o.description = description;
-                o.modified = block_timestamp(now());
+            if (description) {
+                o.description.clear();
+                o.description_hash.emplace(_texts.replace(o.description_hash.value_or(), *description));
             }
-            if (!title.empty()) {
-                o.title = title;
-                o.modified = block_timestamp(now());
+            if (title) {
+                o.title = *title;
             }
+            o.modified = block_timestamp(now());
         });
+        charge(*proposal_ptr, true);
     }
 
     /**
       * @brief delpropos deletes proposal
+      * @param pool pool ID, the token symbol code of the app domain
       * @param proposal_id proposal ID to delete
       */
     [[eosio::action]]
-    void delpropos(proposal_id_t proposal_id) {
+    void delpropos(eosio::symbol_code pool, proposal_id_t proposal_id) {
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_TSPEC_APP, "invalid state for delpropos");
-        eosio_assert(proposal_ptr->type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_DELPROPOS>(*proposal_ptr);
         require_app_member(proposal_ptr->author);
 
-        auto tspec_index = _proposal_tspecs.get_index<"foreign"_n>();
-        auto tspec_lower_bound = tspec_index.lower_bound(proposal_id);
-
-
-        for (auto tspec_ptr = tspec_lower_bound; tspec_ptr != tspec_index.upper_bound(proposal_id); tspec_ptr++) {
-            eosio_assert(_proposal_tspec_votes.count_positive(tspec_ptr->id) == 0, "proposal contains partly-approved technical specification applications");
+        auto tspecs = foreign_range(_proposal_tspecs, proposal_id);
+        for (const tspec_app_t &tspec_app : tspecs) {
+            eosio_assert(_proposal_tspec_votes.count_positive(tspec_app.id) == 0, "proposal contains partly-approved technical specification applications");
         }
 
         _proposal_comments.erase_all(proposal_id);
@@ -630,21 +2390,40 @@ public:
         _proposal_status_comments.erase_all(proposal_id);
         _proposal_votes.erase_all(proposal_id);
 
-        for (auto tspec_ptr = tspec_lower_bound; tspec_ptr != tspec_index.upper_bound(proposal_id); ) {
-            del_tspec(*(tspec_ptr++));
+        tspecs.erase_n(std::numeric_limits<size_t>::max(), [&](const tspec_app_t &tspec_app) {
+            release_tspec(tspec_app);
+        });
+
+        // the deposit locked by setfund goes back to the fund, the event reports the proposal as it is left by the refund
+        proposal_t proposal = *proposal_ptr;
+        if (proposal.deposit.amount > 0) {
+            refund(proposal, proposal.author);
         }
 
+        charge(*proposal_ptr, false);
+        _usage.erase_proposal(proposal_id);
+        _texts.release(proposal_ptr->description_hash.value_or());
+        auto summary_ptr = _proposal_summaries.find(proposal_id);
+        if (summary_ptr != _proposal_summaries.end()) {
+            _proposal_summaries.erase(summary_ptr);
+        }
+        auto deadline_ptr = _deadlines.find(proposal_id);
+        if (deadline_ptr != _deadlines.end()) {
+            _deadlines.erase(deadline_ptr);
+        }
+        send_event(_self, "eventpropos"_n, _pool, proposal_id, uint8_t(0) /* deleted */, proposal.tspec_id, proposal.deposit);
         _proposals.erase(proposal_ptr);
     }
 
     /**
        * @brief votepropos places a vote for the proposal
+       * @param pool pool ID, the token symbol code of the app domain
        * @param proposal_id proposal ID
        * @param author name of the voting account
        * @param vote 1 for positive vote, 0 for negative vote. Look at the voting_module_t::vote_t
        */
     [[eosio::action]]
-    void votepropos(proposal_id_t proposal_id, eosio::name voter, uint8_t positive)
+    void votepropos(eosio::symbol_code pool, proposal_id_t proposal_id, eosio::name voter, uint8_t positive)
     {
         auto proposal_ptr = _proposals.find(proposal_id);
         eosio_assert(proposal_ptr != _proposals.end(), "proposal has not been found");
@@ -656,73 +2435,103 @@ public:
             .voter = voter,
             .positive = positive != 0
         };
-        _proposal_votes.vote(vote);
+        const vote_event_t previous = _proposal_votes.vote(vote);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            proposal_summary_t::count_vote(obj.positive_votes, obj.negative_votes, previous, vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE);
+        });
+        _proposal_vote_weights.refresh(voter, refresh_batch_size);
     }
 
     /**
      * @brief addcomment publish a new comment to the proposal
+     * @param pool pool ID, the token symbol code of the app domain
      * @param proposal_id proposal ID
      * @param comment_id comment ID
      * @param author author of the comment
      * @param data comment data
      */
     [[eosio::action]]
-    void addcomment(proposal_id_t proposal_id, comment_id_t comment_id, eosio::name author, const comment_data_t &data) {
+    void addcomment(eosio::symbol_code pool, proposal_id_t proposal_id, comment_id_t comment_id, eosio::name author, const comment_data_t &data) {
+        addcomment_view(pool, proposal_id, comment_id, author, data);
+    }
+
+    // addcomment with the text referring to the action data, dispatched by apply()
+    void addcomment_view(eosio::symbol_code pool, proposal_id_t proposal_id, comment_id_t comment_id, eosio::name author, const comment_view_t &data) {
         const proposal_t &proposal = _proposals.get(proposal_id);
-        eosio_assert(proposal.state != proposal_t::STATE_CLOSED, "invalid state for addcomment");
+        require_rule<proposal_rules::ACTION_ADDCOMMENT>(proposal);
 
         LOG("proposal_id: %, comment_id: %, author: %", proposal_id, comment_id, ACCOUNT_NAME_CSTR(author));
         _proposal_comments.add(comment_id, proposal_id, author, data);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            obj.comments_count++;
+        });
     }
 
     /**
    * @brief editcomment modifies existing comment
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param comment_id comment ID
    * @param data comment's data, live empty fileds that shouldn't be modified
    */
     [[eosio::action]]
-    void editcomment(comment_id_t comment_id, const comment_data_t &data)
+    void editcomment(eosio::symbol_code pool, comment_id_t comment_id, const comment_data_t &data)
+    {
+        editcomment_view(pool, comment_id, data);
+    }
+
+    // editcomment with the text referring to the action data, dispatched by apply()
+    void editcomment_view(eosio::symbol_code pool, comment_id_t comment_id, const comment_view_t &data)
     {
         LOG("comment_id: %", comment_id);
 
         const proposal_id_t proposal_id = _proposal_comments.comments.get(comment_id).foreign_id;
         const proposal_t& proposal = _proposals.get(proposal_id);
-        eosio_assert(proposal.state != proposal_t::STATE_CLOSED, "invalid state for addcomment");
+        require_rule<proposal_rules::ACTION_EDITCOMMENT>(proposal);
 
         _proposal_comments.edit(comment_id, data);
     }
 
     /**
    * @brief delcomment deletes comment
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param comment_id comment ID to delete
    */
     [[eosio::action]]
-    void delcomment(comment_id_t comment_id) {
+    void delcomment(eosio::symbol_code pool, comment_id_t comment_id) {
         LOG("comment_id: %", comment_id);
 
         const proposal_id_t proposal_id = _proposal_comments.comments.get(comment_id).foreign_id;
         const proposal_t &proposal = _proposals.get(proposal_id);
-        eosio_assert(proposal.state != proposal_t::STATE_CLOSED, "invalid state for addcomment");
+        require_rule<proposal_rules::ACTION_DELCOMMENT>(proposal);
 
         _proposal_comments.del(comment_id);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            obj.comments_count--;
+        });
     }
 
     /**
    * @brief addtspec publish a new technical specification application
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param tspec_id technical speification aplication ID
    * @param author author of the technical specification application
    * @param tspec technical specification details
    */
     [[eosio::action]]
-    void addtspec(proposal_id_t proposal_id, tspec_id_t tspec_app_id, eosio::name author, const tspec_data_t &tspec)
+    void addtspec(eosio::symbol_code pool, proposal_id_t proposal_id, tspec_id_t tspec_app_id, eosio::name author, const tspec_data_t &tspec)
+    {
+        addtspec_view(pool, proposal_id, tspec_app_id, author, tspec);
+    }
+
+    // addtspec with the text referring to the action data, dispatched by apply()
+    void addtspec_view(eosio::symbol_code pool, proposal_id_t proposal_id, tspec_id_t tspec_app_id, eosio::name author, const tspec_view_t &tspec)
     {
         LOG("proposal_id: %, tspec_id: %, author: %", proposal_id, tspec_app_id, ACCOUNT_NAME_CSTR(author));
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->type == proposal_t::TYPE_1, "unsupported action");
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_TSPEC_APP, "invalid state for addtspec");
+        require_rule<proposal_rules::ACTION_ADDTSPEC>(*proposal_ptr);
 
         eosio_assert(get_state().token_symbol == tspec.specification_cost.symbol, "invalid symbol for the specification cost");
         eosio_assert(get_state().token_symbol == tspec.development_cost.symbol, "invalid symbol for the development cost");
@@ -730,52 +2539,69 @@ public:
         _proposal_tspecs.emplace(author, [&](tspec_app_t &spec) {
             spec.id = tspec_app_id;
             spec.author = author;
-            spec.data = tspec;
+            spec.data = tspec.without_text();
+            spec.text_hash.emplace(_texts.add(tspec.text));
             spec.foreign_id = proposal_id;
             spec.created = TIMESTAMP_NOW;
             spec.modified = TIMESTAMP_UNDEFINED;
+            spec.version.emplace(row_version);
+        });
+        charge(_proposal_tspecs.get(tspec_app_id), true);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            obj.tspecs_count++;
         });
+        // the application can be approved during voting_time_s
+        update_deadline(*proposal_ptr, author, true);
     }
 
     /**
    * @brief edittspec modifies technical specification application
-   * @param proposal_id proposal ID
+   * @param pool pool ID, the token symbol code of the app domain
    * @param tspec_app_id technical specification application ID
-   * @param author author of the technical specification
-   * @param tspec technical specification details
+   * @param patch technical specification fields to modify, live null fields that shouldn't be modified
    */
     [[eosio::action]]
-    void edittspec(tspec_id_t tspec_app_id, const tspec_data_t &tspec) {
+    void edittspec(eosio::symbol_code pool, tspec_id_t tspec_app_id, const tspec_patch_t &patch) {
+        edittspec_view(pool, tspec_app_id, patch);
+    }
+
+    // edittspec with the text referring to the action data, dispatched by apply()
+    void edittspec_view(eosio::symbol_code pool, tspec_id_t tspec_app_id, const tspec_patch_view_t &patch) {
         const tspec_app_t &tspec_app = _proposal_tspecs.get(tspec_app_id);
         const proposal_t &proposal = _proposals.get(tspec_app.foreign_id);
         LOG("proposal_id: %, tspec_id: %", proposal.id, tspec_app.id);
 
-        eosio_assert(proposal.state == proposal_t::STATE_TSPEC_APP || 
-                     proposal.state == proposal_t::STATE_TSPEC_CREATE, "invalid state for edittspec");
-        eosio_assert(proposal.type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_EDITTSPEC>(proposal);
+        eosio_assert(!patch.empty(), "nothing to modify");
 
-        eosio_assert(get_state().token_symbol == tspec.specification_cost.symbol, "invalid symbol for the specification cost");
-        eosio_assert(get_state().token_symbol == tspec.development_cost.symbol, "invalid symbol for the development cost");
+        eosio_assert(!patch.specification_cost || get_state().token_symbol == patch.specification_cost->symbol, "invalid symbol for the specification cost");
+        eosio_assert(!patch.development_cost || get_state().token_symbol == patch.development_cost->symbol, "invalid symbol for the development cost");
 
         require_app_member(tspec_app.author);
 
+        charge(tspec_app, false);
         _proposal_tspecs.modify(tspec_app, tspec_app.author, [&](tspec_app_t &obj) {
-            obj.modify(tspec, proposal.state == proposal_t::STATE_TSPEC_CREATE /* limited */);
+            obj.modify(patch, proposal.state == proposal_t::STATE_TSPEC_CREATE /* limited */);
+            if (patch.text) {
+                obj.data.text.clear();
+                obj.text_hash.emplace(_texts.replace(obj.text_hash.value_or(), *patch.text));
+            }
         });
+        charge(tspec_app, true);
     }
 
     /**
    * @brief deltspec deletes technical specification application
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param tspec_app_id technical specification application ID
    */
     [[eosio::action]]
-    void deltspec(tspec_id_t tspec_app_id)
+    void deltspec(eosio::symbol_code pool, tspec_id_t tspec_app_id)
     {
         const tspec_app_t &tspec_app = _proposal_tspecs.get(tspec_app_id);
         const proposal_t &proposal = _proposals.get(tspec_app.foreign_id);
-        eosio_assert(proposal.type == proposal_t::TYPE_1, "unsupported action");
-        eosio_assert(proposal.state == proposal_t::STATE_TSPEC_APP, "invalid state for deltspec");
+        require_rule<proposal_rules::ACTION_DELTSPEC>(proposal);
         eosio_assert(_proposal_tspec_votes.count_positive(tspec_app_id) == 0, "upvoted technical specification application can be removed");
 
         require_app_member(tspec_app.author);
@@ -783,11 +2609,17 @@ public:
         eosio_assert(_proposal_tspec_votes.count_positive(tspec_app.foreign_id) == 0,
                      "technical specification application can't be deleted because it already has been upvoted"); //Technical Specification 1.e
 
-        del_tspec(tspec_app);
+        const proposal_id_t proposal_id = proposal.id;
+        const size_t comments_count = del_tspec(tspec_app);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            obj.tspecs_count--;
+            obj.tspec_comments_count -= comments_count;
+        });
     }
 
     /**
    * @brief approvetspec votes for the technical specification application
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param tspec_app_id technical specification application
    * @param author voting account name
@@ -795,15 +2627,14 @@ public:
    * @param comment attached comment data
    */
     [[eosio::action]]
-    void approvetspec(tspec_id_t tspec_app_id, eosio::name author, comment_id_t comment_id, const comment_data_t &comment) {
+    void approvetspec(eosio::symbol_code pool, tspec_id_t tspec_app_id, eosio::name author, comment_id_t comment_id, const comment_data_t &comment) {
         LOG("tpsec.id: %, author: %, comment.id: % comment.text: %", tspec_app_id, ACCOUNT_NAME_CSTR(author), comment_id, comment.text.c_str());
 
         const tspec_app_t &tspec_app = _proposal_tspecs.get(tspec_app_id);
         proposal_id_t proposal_id = tspec_app.foreign_id;
         const proposal_t &proposal = _proposals.get(proposal_id);
 
-        eosio_assert(proposal.state == proposal_t::STATE_TSPEC_APP, "invalid state for approvetspec");
-        eosio_assert(proposal.type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_APPROVETSPEC>(proposal);
 
         require_app_delegate(author);
         eosio_assert(voting_time_s + tspec_app.created.to_time_point().sec_since_epoch() >= now(), "approve time is over");
@@ -811,6 +2642,9 @@ public:
         if (!comment.text.empty())
         {
             _proposal_tspec_comments.add(comment_id, tspec_app_id, author, comment);
+            update_summary(proposal_id, [&](proposal_summary_t &obj) {
+                obj.tspec_comments_count++;
+            });
         }
 
         _proposal_tspec_votes.approve(tspec_app_id, author);
@@ -823,22 +2657,25 @@ public:
             _proposals.modify(proposal, author, [&](proposal_t &obj) {
                 choose_proposal_tspec(obj, tspec_app);
             });
+            notify(proposal);
+            update_deadline(proposal, author);
+            reclaim_tspecs(proposal, reclaim_step_rows);
         }
     }
 
     /**
      * @brief approvetspec unapprove technical specification application
+     * @param pool pool ID, the token symbol code of the app domain
      **/
     [[eosio::action]]
-    void dapprovetspec(tspec_id_t tspec_app_id, eosio::name author) {
+    void dapprovetspec(eosio::symbol_code pool, tspec_id_t tspec_app_id, eosio::name author) {
         LOG("tpsec.id: %, author: %", tspec_app_id, ACCOUNT_NAME_CSTR(author));
 
         const tspec_app_t &tspec_app = _proposal_tspecs.get(tspec_app_id);
         proposal_id_t proposal_id = tspec_app.foreign_id;
         const proposal_t &proposal = _proposals.get(proposal_id);
 
-        eosio_assert(proposal.state == proposal_t::STATE_TSPEC_APP, "invalid state for dapprovetspec");
-        eosio_assert(proposal.type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_DAPPROVETSPEC>(proposal);
 
         require_auth(author);
         eosio_assert(voting_time_s + tspec_app.created.to_time_point().sec_since_epoch() >= now(), "approve time is over");
@@ -848,15 +2685,15 @@ public:
 
     /**
    * @brief startwork chooses worker account and allows the worker to start work on the proposal
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param worker worker account name
    */
     [[eosio::action]]
-    void startwork(proposal_id_t proposal_id, eosio::name worker) {
+    void startwork(eosio::symbol_code pool, proposal_id_t proposal_id, eosio::name worker) {
         LOG("proposal_id: %, worker: %", proposal_id, ACCOUNT_NAME_CSTR(worker));
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_TSPEC_CREATE, "invalid state for startwork");
-        eosio_assert(proposal_ptr->type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_STARTWORK>(*proposal_ptr);
 
         const tspec_app_t& tspec_app = _proposal_tspecs.get(proposal_ptr->tspec_id);
         require_auth(tspec_app.author);
@@ -866,20 +2703,22 @@ public:
             proposal.work_begining_time = TIMESTAMP_NOW;
             proposal.set_state(proposal_t::STATE_WORK);
         });
+        notify(*proposal_ptr);
+        update_deadline(*proposal_ptr, tspec_app.author);
     }
 
     /**
    * @brief cancelwork cancels work. Can be called by the worker or technical specification author
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id propsal ID
    * @param initiator a cancel initiator's account name
    */
     [[eosio::action]]
-    void cancelwork(proposal_id_t proposal_id, eosio::name initiator)
+    void cancelwork(eosio::symbol_code pool, proposal_id_t proposal_id, eosio::name initiator)
     {
         LOG("proposal_id: %, initiator: %", proposal_id, ACCOUNT_NAME_CSTR(initiator));
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_WORK, "invalid state for cancelwork");
-        eosio_assert(proposal_ptr->type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_CANCELWORK>(*proposal_ptr);
 
         if (initiator == proposal_ptr->worker)
         {
@@ -895,37 +2734,42 @@ public:
             refund(proposal, initiator);
             close(proposal);
         });
+        notify(*proposal_ptr);
+        update_deadline(*proposal_ptr, initiator);
     }
 
     /**
    * @brief poststatus post status for the work done
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param comment_id comment ID
    * @param comment comment data
    */
     [[eosio::action]]
-    void poststatus(proposal_id_t proposal_id, comment_id_t comment_id, const comment_data_t &comment) {
+    void poststatus(eosio::symbol_code pool, proposal_id_t proposal_id, comment_id_t comment_id, const comment_data_t &comment) {
         LOG("proposal_id: %, comment: %", proposal_id, comment.text.c_str());
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_WORK, "invalid state for poststatus");
-        eosio_assert(proposal_ptr->type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_POSTSTATUS>(*proposal_ptr);
         require_auth(proposal_ptr->worker);
         _proposal_status_comments.add(comment_id, proposal_ptr->id, proposal_ptr->worker, comment);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            obj.status_comments_count++;
+        });
     }
 
     /**
    * @brief acceptwork accepts a work that was done by the worker. Can be called only by the technical specification author
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param comment_id comment ID
    * @param comment
    */
     [[eosio::action]]
-    void acceptwork(proposal_id_t proposal_id, comment_id_t comment_id, const comment_data_t &comment)
+    void acceptwork(eosio::symbol_code pool, proposal_id_t proposal_id, comment_id_t comment_id, const comment_data_t &comment)
     {
         LOG("proposal_id: %, comment: %", proposal_id, comment.text.c_str());
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_WORK, "invalid state for acceptwork");
-        eosio_assert(proposal_ptr->type == proposal_t::TYPE_1, "unsupported action");
+        require_rule<proposal_rules::ACTION_ACCEPTWORK>(*proposal_ptr);
 
         const tspec_app_t& tspec_app = _proposal_tspecs.get(proposal_ptr->tspec_id);
         require_auth(tspec_app.author);
@@ -933,12 +2777,18 @@ public:
         _proposals.modify(proposal_ptr, tspec_app.author, [&](auto &proposal) {
             proposal.set_state(proposal_t::STATE_DELEGATES_REVIEW);
         });
+        notify(*proposal_ptr);
+        update_deadline(*proposal_ptr, tspec_app.author);
 
         _proposal_status_comments.add(comment_id, proposal_ptr->id, tspec_app.author, comment);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            obj.status_comments_count++;
+        });
     }
 
     /**
    * @brief reviewwork posts delegate's review
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal ID
    * @param reviewer delegate's account name
    * @param status 0 - reject, 1 - approve. Look at the proposal_t::review_status_t
@@ -946,7 +2796,7 @@ public:
    * @param comment comment data, live empty if it isn't required
    */
     [[eosio::action]]
-    void reviewwork(proposal_id_t proposal_id, eosio::name reviewer, uint8_t status, comment_id_t comment_id, const comment_data_t &comment) {
+    void reviewwork(eosio::symbol_code pool, proposal_id_t proposal_id, eosio::name reviewer, uint8_t status, comment_id_t comment_id, const comment_data_t &comment) {
         LOG("proposal_id: %, comment: %, status: %, reviewer: %", proposal_id, comment.text.c_str(), (int)status, ACCOUNT_NAME_CSTR(reviewer));
         require_app_delegate(reviewer);
         auto proposal_ptr = get_proposal(proposal_id);
@@ -958,16 +2808,18 @@ public:
             .foreign_id = proposal_id
         };
 
-        _proposal_review_votes.vote(vote);
+        const vote_event_t previous = _proposal_review_votes.vote(vote);
+        update_summary(proposal_id, [&](proposal_summary_t &obj) {
+            proposal_summary_t::count_vote(obj.positive_reviews, obj.negative_reviews, previous, vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE);
+        });
 
+        const uint8_t state = proposal_ptr->state;
         _proposals.modify(proposal_ptr, reviewer, [&](proposal_t &proposal) {
             switch (static_cast<proposal_t::review_status_t>(status))
             {
             case proposal_t::STATUS_REJECT:
             {
-                eosio_assert(proposal.state == proposal_t::STATE_DELEGATES_REVIEW ||
-                             proposal.state == proposal_t::STATE_WORK,
-                             "invalid state for negative review");
+                require_rule<proposal_rules::ACTION_REJECT_REVIEW>(proposal);
 
                 size_t negative_votes_count = _proposal_review_votes.count_negative(proposal_id);
                 if (negative_votes_count >= wintess_count_75)
@@ -982,7 +2834,7 @@ public:
 
             case proposal_t::STATUS_ACCEPT:
             {
-                eosio_assert(proposal_ptr->state == proposal_t::STATE_DELEGATES_REVIEW, "invalid state for positive review");
+                require_rule<proposal_rules::ACTION_ACCEPT_REVIEW>(proposal);
 
                 size_t positive_votes_count = _proposal_review_votes.count_positive(proposal_id);
                 if (positive_votes_count >= witness_count_51)
@@ -1002,18 +2854,24 @@ public:
             }
             }
         });
+
+        if (proposal_ptr->state != state) {
+            notify(*proposal_ptr);
+            update_deadline(*proposal_ptr, reviewer);
+        }
     }
 
     /**
    * @brief withdraw withdraws scheduled payment to the worker account
+   * @param pool pool ID, the token symbol code of the app domain
    * @param proposal_id proposal id
    */
     [[eosio::action]]
-    void withdraw(proposal_id_t proposal_id)
+    void withdraw(eosio::symbol_code pool, proposal_id_t proposal_id)
     {
         LOG("proposal_id: %", proposal_id);
         auto proposal_ptr = get_proposal(proposal_id);
-        eosio_assert(proposal_ptr->state == proposal_t::STATE_PAYMENT, "invalid state for withdraw");
+        require_rule<proposal_rules::ACTION_WITHDRAW>(*proposal_ptr);
 
         const tspec_app_t& tspec_app = _proposal_tspecs.get(proposal_ptr->tspec_id);
         const tspec_data_t& tspec = tspec_app.data;
@@ -1060,6 +2918,8 @@ public:
                 close(proposal);
             }
         });
+        notify(*proposal_ptr);
+        record(MOVEMENT_PAYOUT, proposal_ptr->fund_name, proposal_id, quantity);
 
         action(permission_level{_self, "active"_n},
                TOKEN_ACCOUNT, "transfer"_n,
@@ -1068,50 +2928,554 @@ public:
                 .send();
     }
 
+    /**
+   * @brief sweep closes the proposals that have passed their deadline and refunds their deposits, can be called by anyone
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param max_count maximum number of the proposals to close, the rest is left to the next call
+   */
+    [[eosio::action]]
+    void sweep(eosio::symbol_code pool, uint16_t max_count) {
+        eosio_assert(max_count > 0, "invalid proposals count");
+
+        auto deadline_index = _deadlines.get_index<"deadline"_n>();
+        // the swept deadlines are erased before the bound, it stays valid
+        const auto deadline_end = deadline_index.upper_bound(now());
+        uint16_t count = 0;
+        for (auto deadline_ptr = deadline_index.begin(); deadline_ptr != deadline_end && count < max_count; count++) {
+            const proposal_id_t proposal_id = deadline_ptr->id;
+            deadline_ptr = deadline_index.erase(deadline_ptr);
+
+            const proposal_t &proposal = _proposals.get(proposal_id);
+            LOG("proposal % has expired in the state %", proposal_id, int(proposal.state));
+            _proposals.modify(proposal, keep_payer(proposal), [&](proposal_t &obj) {
+                if (obj.deposit.amount > 0) {
+                    refund(obj, name());
+                }
+                if (obj.state == proposal_t::STATE_TSPEC_APP) {
+                    obj.tspec_id = proposal_t::NO_TSPEC;
+                }
+                close(obj);
+            });
+            notify(proposal);
+            // the rest of the applications is left to reclaimtspec
+            reclaim_tspecs(proposal, reclaim_step_rows);
+        }
+        eosio_assert(count > 0, "nothing to sweep");
+    }
+
+    /**
+   * @brief reclaimtspec erases the technical specification applications that lost the selection, can be called by anyone
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param proposal_id proposal ID
+   * @param max_rows maximum number of the rows to erase, the rest is left to the next call
+   */
+    [[eosio::action]]
+    void reclaimtspec(eosio::symbol_code pool, proposal_id_t proposal_id, uint16_t max_rows) {
+        const proposal_t &proposal = _proposals.get(proposal_id);
+        require_rule<proposal_rules::ACTION_RECLAIMTSPEC>(proposal);
+        eosio_assert(max_rows > 0, "invalid rows count");
+        eosio_assert(reclaim_tspecs(proposal, max_rows) > 0, "nothing to reclaim");
+    }
+
+    /**
+   * @brief revokevotes revokes the technical specification approvals and the work reviews of a delegate who has left,
+   * the votes for the proposals that have passed the voting are kept. Repeat it while the revocations row of the voter exists
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param voter the delegate account
+   * @param max_count maximum number of the votes to visit, the rest is left to the next call
+   */
+    [[eosio::action]]
+    void revokevotes(eosio::symbol_code pool, eosio::name voter, uint16_t max_count) {
+        require_auth(_self);
+
+        auto revocation_ptr = _revocations.find(voter.value);
+        revocation_t revocation = revocation_ptr != _revocations.end() ? *revocation_ptr : revocation_t{voter, 0, 0};
+        size_t limit = max_count;
+
+        if (revocation.tspec_vote_id != no_vote) {
+            revocation.tspec_vote_id = _proposal_tspec_votes.revoke(voter, revocation.tspec_vote_id, limit, [&](const vote_t &vote) {
+                const tspec_app_t &tspec_app = _proposal_tspecs.get(vote.foreign_id);
+                return _proposals.get(tspec_app.foreign_id).state == proposal_t::STATE_TSPEC_APP;
+            });
+        }
+
+        if (revocation.review_vote_id != no_vote) {
+            revocation.review_vote_id = _proposal_review_votes.revoke(voter, revocation.review_vote_id, limit, [&](const vote_t &vote) {
+                // the reviews are cast while the work is going on and after it is accepted
+                const uint8_t state = _proposals.get(vote.foreign_id).state;
+                if (state != proposal_t::STATE_WORK && state != proposal_t::STATE_DELEGATES_REVIEW) {
+                    return false;
+                }
+                update_summary(vote.foreign_id, [&](proposal_summary_t &obj) {
+                    proposal_summary_t::count_vote(obj.positive_reviews, obj.negative_reviews,
+                        vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE, VOTE_REVOKED);
+                });
+                return true;
+            });
+        }
+
+        eosio_assert(limit < max_count, "nothing to revoke");
+        LOG("voter: %, visited % votes", ACCOUNT_NAME_CSTR(voter), max_count - limit);
+
+        if (revocation.tspec_vote_id == no_vote && revocation.review_vote_id == no_vote) {
+            if (revocation_ptr != _revocations.end()) {
+                _revocations.erase(revocation_ptr);
+            }
+        } else if (revocation_ptr == _revocations.end()) {
+            _revocations.emplace(_self, [&](revocation_t &obj) {
+                obj = revocation;
+            });
+        } else {
+            _revocations.modify(revocation_ptr, name(), [&](revocation_t &obj) {
+                obj = revocation;
+            });
+        }
+    }
+
+    /**
+   * @brief setquotas limits the table space an account or a proposal may take, see usage_module_t
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param account_bytes the limit of the proposals, applications, comments and votes of an account, 0 is no limit
+   * @param proposal_bytes the limit of a proposal with its applications and comments, 0 is no limit
+   */
+    [[eosio::action]]
+    void setquotas(eosio::symbol_code pool, uint64_t account_bytes, uint64_t proposal_bytes) {
+        require_auth(_self);
+        require_pool();
+        _usage.quotas.set(quotas_t{account_bytes, proposal_bytes}, _self);
+    }
+
+    /**
+   * @brief weighvotes turns on the stake-weighted tallies of the proposal votes, the votes cast before are weighed by syncsummary
+   * @param pool pool ID, the token symbol code of the app domain
+   */
+    [[eosio::action]]
+    void weighvotes(eosio::symbol_code pool) {
+        require_auth(_self);
+        require_pool();
+        eosio_assert(!_proposal_vote_weights.weighting.exists(), "the votes are already weighted");
+        _proposal_vote_weights.weighting.set(weighting_t{TIMESTAMP_NOW}, _self);
+    }
+
+    /**
+   * @brief setbalance sets the balance the votes of the account are weighed with, the votes aren't refreshed
+   * until the account votes or refreshvotes is called
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param account app domain member
+   * @param quantity the balance in the pool tokens
+   */
+    [[eosio::action]]
+    void setbalance(eosio::symbol_code pool, eosio::name account, asset quantity) {
+        require_auth(_self);
+        eosio_assert(quantity.symbol == get_state().token_symbol, "invalid token symbol");
+        eosio_assert(quantity.amount >= 0, "balance must not be negative");
+
+        _proposal_vote_weights.set_balance(account, quantity, _self);
+    }
+
+    /**
+   * @brief setproxy delegates the voting weight of the member to the proxy, the proxy votes count for the member with it.
+   * The votes weighed before are refreshed lazily, see refreshvotes
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param account app domain member
+   * @param proxy the proxy account, empty to vote with the own weight again
+   */
+    [[eosio::action]]
+    void setproxy(eosio::symbol_code pool, eosio::name account, eosio::name proxy) {
+        require_pool();
+        require_app_member(account);
+        eosio_assert(account != proxy, "an account can't be its own proxy");
+        _proposal_vote_weights.set_proxy(account, proxy, account);
+    }
+
+    /**
+   * @brief refreshvotes reweighs the votes of the account cast before its weight changed
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param voter voting account name
+   * @param max_count maximum number of the votes to reweigh, the rest is left to the next call
+   */
+    [[eosio::action]]
+    void refreshvotes(eosio::symbol_code pool, eosio::name voter, uint16_t max_count) {
+        const size_t refreshed = _proposal_vote_weights.refresh(voter, max_count);
+        eosio_assert(refreshed > 0, "nothing to refresh");
+        LOG("voter: %, refreshed % votes", ACCOUNT_NAME_CSTR(voter), refreshed);
+    }
+
+    /**
+   * @brief import moves the rows of a worker program kept by another contract to the pool, without replaying
+   * the actions that created them. The rows are checked and added with their summaries, deadlines and usage,
+   * all of them are billed to the contract, no events are sent. The rows of a batch are numbered from `first` in the order of the arguments,
+   * the ones below the import cursor are skipped, so a batch that failed or was cut can be sent again as it is
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param first the number of the first row of the batch in the whole import
+   * @param texts texts the rows refer to by sha256, the texts already stored aren't needed
+   * @param proposals proposal rows, the deposits must be empty, so only the proposals waiting for the applications or closed are taken
+   * @param tspecs technical specification application rows, an inline text is moved to the text store
+   * @param comments discussion comment rows
+   * @param votes proposal vote rows
+   * @param tspec_comments comment rows of the application approvals
+   * @param status_comments status comment rows
+   * @param review_comments review comment rows
+   * @param tspec_votes application approval rows
+   * @param review_votes review vote rows
+   */
+    [[eosio::action]]
+    void import(eosio::symbol_code pool, uint64_t first, const vector<string> &texts, const vector<proposal_t> &proposals,
+                const vector<tspec_app_t> &tspecs, const vector<comment_t> &comments, const vector<vote_t> &votes,
+                const vector<comment_t> &tspec_comments, const vector<comment_t> &status_comments, const vector<comment_t> &review_comments,
+                const vector<vote_t> &tspec_votes, const vector<vote_t> &review_votes) {
+        require_auth(_self);
+        const eosio::symbol token_symbol = get_state().token_symbol;
+        import_state_t cursor = _import_state.get_or_default(import_state_t{0});
+        eosio_assert(first <= cursor.rows, "the batch doesn't continue the import");
+
+        import_texts_t batch_texts;
+        for (const auto &text : texts) {
+            batch_texts[texts_module_t::get_hash(text)] = &text;
+        }
+
+        uint64_t position = first;
+        auto skip = [&]() { return position++ < cursor.rows; };
+        for (const auto &proposal : proposals) {
+            if (!skip()) {
+                import_proposal(proposal, batch_texts);
+            }
+        }
+        for (const auto &tspec_app : tspecs) {
+            if (!skip()) {
+                import_tspec(tspec_app, batch_texts, token_symbol);
+            }
+        }
+        for (const auto &comment : comments) {
+            if (!skip()) {
+                import_comment(_proposal_comments, comment, batch_texts, [&](proposal_summary_t &obj) {
+                    obj.comments_count++;
+                });
+            }
+        }
+        for (const auto &vote : votes) {
+            if (!skip()) {
+                import_vote(_proposal_votes, vote, true, [&](proposal_summary_t &obj) {
+                    proposal_summary_t::count_vote(obj.positive_votes, obj.negative_votes, VOTE_REVOKED, vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE);
+                });
+            }
+        }
+        for (const auto &comment : tspec_comments) {
+            if (!skip()) {
+                import_comment(_proposal_tspec_comments, comment, batch_texts, [&](proposal_summary_t &obj) {
+                    obj.tspec_comments_count++;
+                });
+            }
+        }
+        for (const auto &comment : status_comments) {
+            if (!skip()) {
+                import_comment(_proposal_status_comments, comment, batch_texts, [&](proposal_summary_t &obj) {
+                    obj.status_comments_count++;
+                });
+            }
+        }
+        for (const auto &comment : review_comments) {
+            if (!skip()) {
+                import_comment(_proposal_review_comments, comment, batch_texts, [&](proposal_summary_t &) {});
+            }
+        }
+        for (const auto &vote : tspec_votes) {
+            if (!skip()) {
+                import_vote(_proposal_tspec_votes, vote, false, [&](proposal_summary_t &) {});
+            }
+        }
+        for (const auto &vote : review_votes) {
+            if (!skip()) {
+                import_vote(_proposal_review_votes, vote, true, [&](proposal_summary_t &obj) {
+                    proposal_summary_t::count_vote(obj.positive_reviews, obj.negative_reviews, VOTE_REVOKED, vote.positive ? VOTE_POSITIVE : VOTE_NEGATIVE);
+                });
+            }
+        }
+
+        cursor.rows = std::max(cursor.rows, position);
+        _import_state.set(cursor, _self);
+        LOG("imported rows: %", cursor.rows);
+    }
+
+    /**
+   * @brief migrate rewrites the proposals, tspec applications and comments stored in an older layout in the current one,
+   * goes through the tables in turn and resumes from the row where the previous call stopped. The proposals go first:
+   * until an older proposal is migrated its state and worker can't change. The rows grow, and their
+   * authors can't be billed without their authority, so the rows are billed to the contract and only the contract can call it
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param max_rows the maximum number of the rows to go through
+   */
+    [[eosio::action]]
+    void migrate(eosio::symbol_code pool, uint16_t max_rows) {
+        require_auth(_self);
+        require_pool();
+        eosio_assert(max_rows > 0, "max_rows must be positive");
+
+        migration_t cursor = _migration.get_or_default(migration_t{0, MIGRATE_PROPOSALS, 0});
+        if (cursor.version != row_version) {
+            cursor = migration_t{row_version, MIGRATE_PROPOSALS, 0};
+        }
+        eosio_assert(cursor.table != MIGRATE_DONE, "nothing to migrate");
+
+        uint16_t count = 0;
+        bool done = true;
+        while (cursor.table != MIGRATE_DONE && done) {
+            switch (cursor.table) {
+            case MIGRATE_PROPOSALS:
+                done = migrate_proposals(cursor, count, max_rows);
+                break;
+            case MIGRATE_TSPECS:
+                done = migrate_rows(_proposal_tspecs, cursor, count, max_rows, [&](tspec_app_t &tspec_app, uint8_t version) {
+                    upgrade_row(tspec_app, version);
+                });
+                break;
+            case MIGRATE_PROPOSAL_COMMENTS:
+                done = migrate_comments(_proposal_comments, cursor, count, max_rows);
+                break;
+            case MIGRATE_TSPEC_COMMENTS:
+                done = migrate_comments(_proposal_tspec_comments, cursor, count, max_rows);
+                break;
+            case MIGRATE_STATUS_COMMENTS:
+                done = migrate_comments(_proposal_status_comments, cursor, count, max_rows);
+                break;
+            case MIGRATE_REVIEW_COMMENTS:
+                done = migrate_comments(_proposal_review_comments, cursor, count, max_rows);
+                break;
+            }
+            if (done) {
+                cursor.table++;
+                cursor.next_id = 0;
+            }
+        }
+
+        _migration.set(cursor, _self);
+        LOG("migrated up to the table % row %", int(cursor.table), cursor.next_id);
+    }
+
+    /**
+   * @brief synctotals counts the funds and the deposits into the totals, for the pools funded before the totals were kept.
+   * Goes through the funds and then the proposals, resuming from the row where the previous call stopped. The totals are
+   * removed by the first call and set by the last one, no fund movement is accepted in between. Only the contract account
+   * can call it
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param max_rows the maximum number of the rows to go through
+   */
+    [[eosio::action]]
+    void synctotals(eosio::symbol_code pool, uint16_t max_rows) {
+        require_auth(_self);
+        require_pool();
+        eosio_assert(max_rows > 0, "max_rows must be positive");
+
+        totals_sync_t sync;
+        if (_totals_sync.exists()) {
+            sync = _totals_sync.get();
+        } else {
+            totals_t totals = _totals.get_or_default(totals_t{ZERO_ASSET, ZERO_ASSET, ZERO_ASSET, 0});
+            if (!_totals.exists() && _journal.begin() != _journal.end()) {
+                totals.movements = std::prev(_journal.end())->id + 1;
+            }
+            sync = totals_sync_t{SYNC_FUNDS, 0, ZERO_ASSET, ZERO_ASSET, totals.paid, totals.movements};
+            _totals.remove();
+        }
+
+        uint16_t count = 0;
+        if (sync.stage == SYNC_FUNDS) {
+            auto fund_ptr = _funds.lower_bound(sync.next_id);
+            for (; fund_ptr != _funds.end() && count < max_rows; fund_ptr++, count++) {
+                sync.funds += fund_ptr->quantity;
+            }
+            if (fund_ptr != _funds.end()) {
+                sync.next_id = fund_ptr->primary_key();
+            } else {
+                sync.stage = SYNC_PROPOSALS;
+                sync.next_id = 0;
+            }
+        }
+        if (sync.stage == SYNC_PROPOSALS) {
+            auto proposal_ptr = _proposals.lower_bound(sync.next_id);
+            for (; proposal_ptr != _proposals.end() && count < max_rows; proposal_ptr++, count++) {
+                if (proposal_ptr->deposit.amount > 0) {
+                    sync.deposited += proposal_ptr->deposit;
+                }
+            }
+            if (proposal_ptr == _proposals.end()) {
+                // the paid tokens have left the contract, the rest is held in the funds and the deposits
+                const totals_t totals{sync.funds + sync.deposited + sync.paid, sync.deposited, sync.paid, sync.movements};
+                _totals.set(totals, _self);
+                _totals_sync.remove();
+                LOG("funded: %, deposited: %", totals.funded, totals.deposited);
+                return;
+            }
+            sync.next_id = proposal_ptr->id;
+        }
+        _totals_sync.set(sync, _self);
+    }
+
+    /**
+   * @brief syncsummary recounts the proposal summary from the tables, creates it for the proposals that have none,
+   * rebuilds the tree of the proposal votes and reweighs them if the votes are weighted. Goes through all the votes
+   * of the proposal, so only the contract account can call it, the rebuilt rows are billed to the contract
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param proposal_id proposal ID
+   */
+    [[eosio::action]]
+    void syncsummary(eosio::symbol_code pool, proposal_id_t proposal_id) {
+        require_auth(_self);
+        const proposal_t &proposal = _proposals.get(proposal_id);
+
+        auto summary_ptr = _proposal_summaries.find(proposal_id);
+        if (summary_ptr == _proposal_summaries.end()) {
+            add_summary(proposal, _self);
+        } else {
+            _proposal_summaries.modify(summary_ptr, name(), [&](proposal_summary_t &obj) {
+                obj = count_summary(proposal);
+            });
+        }
+
+        const bool weighted = _proposal_vote_weights.weighting.exists();
+        _proposal_vote_tree.clear(proposal_id);
+        for (const vote_t &vote : foreign_range(_proposal_votes.votes, proposal_id)) {
+            _proposal_vote_tree.insert(vote, _self);
+            if (weighted) {
+                _proposal_vote_weights.remove(vote);
+                _proposal_vote_weights.insert(vote, _self);
+            }
+        }
+    }
+
+    /**
+   * @brief eventpropos notifies about a proposal state transition or deposit change, sent only by the contract itself
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param proposal_id proposal ID
+   * @param state new proposal state, 0 if the proposal has been deleted. Look at the proposal_t::state_t
+   * @param tspec_id chosen technical specification application ID
+   * @param deposit funds deposited to the proposal
+   */
+    [[eosio::action]]
+    void eventpropos(eosio::symbol_code pool, proposal_id_t proposal_id, uint8_t state, tspec_id_t tspec_id, asset deposit) {
+        require_auth(_self);
+    }
+
+    /**
+   * @brief eventfund notifies about a fund movement, sent only by the contract itself
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param fund_name the name of the fund
+   * @param quantity the fund balance after the movement
+   */
+    [[eosio::action]]
+    void eventfund(eosio::symbol_code pool, eosio::name fund_name, asset quantity) {
+        require_auth(_self);
+    }
+
+    /**
+   * @brief eventvote notifies about a tally change, sent only by the contract itself
+   * @param pool pool ID, the token symbol code of the app domain
+   * @param votes_table the votes table name: proposalsv, proposalsrv or proposalstsv
+   * @param foreign_id ID of the proposal or technical specification application voted for
+   * @param voter voting account name
+   * @param vote 1 for positive vote, -1 for negative vote, 0 if the vote has been revoked. Look at the vote_event_t
+   */
+    [[eosio::action]]
+    void eventvote(eosio::symbol_code pool, eosio::name votes_table, uint64_t foreign_id, eosio::name voter, int8_t vote) {
+        require_auth(_self);
+    }
+
     // https://tbfleming.github.io/cib/eos.html#gist=d230f3ab2998e8858d3e51af7e4d9aeb
-    void transfer(const transfer_args& t)
+    // transfer notification with the memo referring to the action data, dispatched by apply(), see transfer_args
+    void transfer_view(eosio::name from, eosio::name to, const asset &quantity, const text_view_t &memo)
     {
-        LOG("transfer % from \"%\" to \"%\"\n", t.quantity, ACCOUNT_NAME_CSTR(t.from), ACCOUNT_NAME_CSTR(t.to));
+        LOG("transfer % from \"%\" to \"%\"\n", quantity, ACCOUNT_NAME_CSTR(from), ACCOUNT_NAME_CSTR(to));
 
-        if (t.memo.size() > 13 || t.to.value != current_receiver()) {
+        if (to.value != current_receiver()) {
             LOG("skiping transfer\n");
             return;
         }
 
-        if (t.quantity.symbol != get_state().token_symbol) {
-            LOG("invalid symbol code: %, expected: %\n", t.quantity.symbol, get_state().token_symbol);
+        const optional<transfer_memo_t> target = transfer_memo_t::parse(std::string_view(memo.data, memo.size), from);
+        if (!target) {
+            LOG("skiping transfer\n");
             return;
         }
 
-        if (t.to != _self || get_code() != TOKEN_ACCOUNT) {
+        if (to != _self || get_code() != TOKEN_ACCOUNT) {
             LOG("invalid beneficiary or contract code\n");
             return;
         }
 
-        const eosio::name &ram_payer = t.to;
-        const name fund_name = name(t.memo);
+        // the tokens addressed to a fund are rejected rather than kept by the contract without a pool to credit
+        require_pool();
+        eosio_assert(quantity.symbol == get_state().token_symbol, "invalid token symbol");
+
+        const eosio::name &ram_payer = to;
+        const name fund_name = target->fund_name;
 
         auto fund_ptr = _funds.find(fund_name.value);
         if (fund_ptr == _funds.end()) {
-            _funds.emplace(ram_payer, [&](auto &fund) {
+            fund_ptr = _funds.emplace(ram_payer, [&](auto &fund) {
                 fund.owner = fund_name;
-                fund.quantity = t.quantity;
+                fund.quantity = quantity;
             });
         } else {
             _funds.modify(fund_ptr, ram_payer, [&](auto &fund) {
-                fund.quantity += t.quantity;
+                fund.quantity += quantity;
             });
         }
-
-        LOG("added % credits to % fund", t.quantity, t.memo.c_str());
+        notify(*fund_ptr);
+        record(MOVEMENT_FUND, fund_name, 0, quantity);
+
+        LOG("added % credits to % fund", quantity, ACCOUNT_NAME_CSTR(fund_name));
+
+        if (target->proposal_id) {
+            // the sponsorship takes one transfer instead of a transfer and setfund, the deposit is locked from the
+            // sender's fund. No authority but the contract's can be billed in a notification,
+            // so a row stored before the version is billed to the contract when it grows
+            auto proposal_ptr = _proposals.find(*target->proposal_id);
+            eosio_assert(proposal_ptr != _proposals.end(), "proposal has not been found");
+            lock_fund(*proposal_ptr, *fund_ptr, quantity, keep_payer(*proposal_ptr));
+        }
     }
 };
+
+// eosio::execute_action that constructs the contract in the scope of the action pool
+template <typename... Args>
+bool execute_pool_action(eosio::name self, eosio::name code, void (worker::*func)(Args...)) {
+    size_t size = action_data_size();
+    constexpr size_t max_stack_buffer_size = 512;
+    void *buffer = nullptr;
+    if (size > 0) {
+        buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+        read_action_data(buffer, size);
+    }
+    std::tuple<std::decay_t<Args>...> args;
+    datastream<const char *> ds((char *)buffer, size);
+    ds >> args;
+
+    worker inst(self, code, ds, worker::pool_of(args));
+    auto f2 = [&](auto... a) { ((&inst)->*func)(a...); };
+    boost::mp11::tuple_apply(f2, args);
+    if (max_stack_buffer_size < size) {
+        free(buffer);
+    }
+    return true;
+}
 } // namespace golos
 
+#define WORKER_DISPATCH(r, TYPE, elem) \
+    case eosio::name(BOOST_PP_STRINGIZE(elem)).value: \
+        golos::execute_pool_action(eosio::name(receiver), eosio::name(code), &TYPE::elem); \
+        break;
+
+// text-heavy actions are unpacked with the texts referring to the action data instead of copying them to std::string
+#define WORKER_DISPATCH_VIEW(r, TYPE, elem) \
+    case eosio::name(BOOST_PP_STRINGIZE(elem)).value: \
+        golos::execute_pool_action(eosio::name(receiver), eosio::name(code), &TYPE::BOOST_PP_CAT(elem, _view)); \
+        break;
+
 extern "C" {
    void apply(uint64_t receiver, uint64_t code, uint64_t action) {
          switch(action) {
-            EOSIO_DISPATCH_HELPER(golos::worker, (createpool)(addpropos2)(addpropos)(setfund)(editpropos)(delpropos)(votepropos)(addcomment)(editcomment)(delcomment)(addtspec)(edittspec)(deltspec)(approvetspec)(dapprovetspec)(startwork)(poststatus)(acceptwork)(reviewwork)(cancelwork)(withdraw)(transfer))
+            BOOST_PP_SEQ_FOR_EACH(WORKER_DISPATCH_VIEW, golos::worker, (addpropos2)(addpropos)(addcomment)(editcomment)(addtspec)(edittspec)(transfer))
+            BOOST_PP_SEQ_FOR_EACH(WORKER_DISPATCH, golos::worker, (createpool)(setfund)(editpropos)(delpropos)(votepropos)(delcomment)(deltspec)(approvetspec)(dapprovetspec)(startwork)(poststatus)(acceptwork)(reviewwork)(cancelwork)(withdraw)(sweep)(reclaimtspec)(revokevotes)(import)(migrate)(setquotas)(weighvotes)(setbalance)(setproxy)(refreshvotes)(synctotals)(syncsummary)(eventpropos)(eventfund)(eventvote))
         }
     }
 }
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+
+// The proposal state machine: which actions are allowed in which proposal state and for which proposal type.
+// It doesn't depend on eosiolib, so clients can include it to validate an action before submitting it
+// and to decode the error codes of the rejected ones.
+namespace golos {
+namespace proposal_rules {
+
+enum state_t : uint8_t {
+    STATE_TSPEC_APP = 1,
+    STATE_TSPEC_CREATE,
+    STATE_WORK,
+    STATE_DELEGATES_REVIEW,
+    STATE_PAYMENT,
+    STATE_CLOSED
+};
+
+enum type_t : uint8_t {
+    TYPE_1,
+    TYPE_2
+};
+
+enum action_t : uint8_t {
+    ACTION_SETFUND,
+    ACTION_EDITPROPOS,
+    ACTION_DELPROPOS,
+    ACTION_ADDCOMMENT,
+    ACTION_EDITCOMMENT,
+    ACTION_DELCOMMENT,
+    ACTION_ADDTSPEC,
+    ACTION_EDITTSPEC,
+    ACTION_DELTSPEC,
+    ACTION_APPROVETSPEC,
+    ACTION_DAPPROVETSPEC,
+    ACTION_STARTWORK,
+    ACTION_CANCELWORK,
+    ACTION_POSTSTATUS,
+    ACTION_ACCEPTWORK,
+    ACTION_REJECT_REVIEW,
+    ACTION_ACCEPT_REVIEW,
+    ACTION_WITHDRAW,
+    ACTION_RECLAIMTSPEC,
+    ACTIONS_COUNT
+};
+
+// error codes passed to eosio_assert_code(), the action is added to the base code
+constexpr uint64_t INVALID_STATE_ERROR = 100;
+constexpr uint64_t UNSUPPORTED_TYPE_ERROR = 200;
+
+constexpr uint64_t invalid_state_code(action_t action) { return INVALID_STATE_ERROR + action; }
+constexpr uint64_t unsupported_type_code(action_t action) { return UNSUPPORTED_TYPE_ERROR + action; }
+
+constexpr uint8_t state_bit(state_t state) { return 1 << state; }
+constexpr uint8_t type_bit(type_t type) { return 1 << type; }
+
+constexpr uint8_t ANY_TYPE = type_bit(TYPE_1) | type_bit(TYPE_2);
+constexpr uint8_t NOT_CLOSED = state_bit(STATE_TSPEC_APP) | state_bit(STATE_TSPEC_CREATE) | state_bit(STATE_WORK) |
+                               state_bit(STATE_DELEGATES_REVIEW) | state_bit(STATE_PAYMENT);
+constexpr uint8_t TSPEC_CHOSEN = state_bit(STATE_TSPEC_CREATE) | state_bit(STATE_WORK) | state_bit(STATE_DELEGATES_REVIEW) |
+                                 state_bit(STATE_PAYMENT) | state_bit(STATE_CLOSED);
+
+struct rule_t {
+    action_t action;
+    uint8_t states;
+    uint8_t types;
+
+    constexpr bool allows_state(uint8_t state) const { return state < 8 && (states & (1 << state)) != 0; }
+    constexpr bool allows_type(uint8_t type) const { return type < 8 && (types & (1 << type)) != 0; }
+};
+
+constexpr rule_t rules[ACTIONS_COUNT] = {
+    {ACTION_SETFUND, state_bit(STATE_TSPEC_APP), ANY_TYPE},
+    {ACTION_EDITPROPOS, state_bit(STATE_TSPEC_APP), ANY_TYPE},
+    {ACTION_DELPROPOS, state_bit(STATE_TSPEC_APP), type_bit(TYPE_1)},
+    {ACTION_ADDCOMMENT, NOT_CLOSED, ANY_TYPE},
+    {ACTION_EDITCOMMENT, NOT_CLOSED, ANY_TYPE},
+    {ACTION_DELCOMMENT, NOT_CLOSED, ANY_TYPE},
+    {ACTION_ADDTSPEC, state_bit(STATE_TSPEC_APP), type_bit(TYPE_1)},
+    {ACTION_EDITTSPEC, state_bit(STATE_TSPEC_APP) | state_bit(STATE_TSPEC_CREATE), type_bit(TYPE_1)},
+    {ACTION_DELTSPEC, state_bit(STATE_TSPEC_APP), type_bit(TYPE_1)},
+    {ACTION_APPROVETSPEC, state_bit(STATE_TSPEC_APP), type_bit(TYPE_1)},
+    {ACTION_DAPPROVETSPEC, state_bit(STATE_TSPEC_APP), type_bit(TYPE_1)},
+    {ACTION_STARTWORK, state_bit(STATE_TSPEC_CREATE), type_bit(TYPE_1)},
+    {ACTION_CANCELWORK, state_bit(STATE_WORK), type_bit(TYPE_1)},
+    {ACTION_POSTSTATUS, state_bit(STATE_WORK), type_bit(TYPE_1)},
+    {ACTION_ACCEPTWORK, state_bit(STATE_WORK), type_bit(TYPE_1)},
+    {ACTION_REJECT_REVIEW, state_bit(STATE_WORK) | state_bit(STATE_DELEGATES_REVIEW), ANY_TYPE},
+    {ACTION_ACCEPT_REVIEW, state_bit(STATE_DELEGATES_REVIEW), ANY_TYPE},
+    {ACTION_WITHDRAW, state_bit(STATE_PAYMENT), ANY_TYPE},
+    {ACTION_RECLAIMTSPEC, TSPEC_CHOSEN, type_bit(TYPE_1)}
+};
+
+constexpr bool rules_are_ordered() {
+    for (uint8_t i = 0; i < ACTIONS_COUNT; i++) {
+        if (rules[i].action != i) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(rules_are_ordered(), "proposal rules should be listed in the order of the actions");
+
+// returns 0 if the action is allowed for the proposal, or the error code the contract rejects it with
+constexpr uint64_t check(action_t action, uint8_t state, uint8_t type) {
+    return !rules[action].allows_state(state) ? invalid_state_code(action) :
+           !rules[action].allows_type(type) ? unsupported_type_code(action) : 0;
+}
+
+} // namespace proposal_rules
+} // namespace golos
@@ -2,11 +2,16 @@
 #include <boost/format.hpp>
 #include <eosio/testing/tester.hpp>
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/resource_limits.hpp>
 #include <memory>
 #include "Runtime/Runtime.h"
 #include <iostream>
 #include <fc/variant_object.hpp>
+#include <fc/crypto/sha256.hpp>
 #include "contracts.hpp"
+#include "../golos.worker/proposal_rules.hpp"
+#include "../golos.worker.indexer/worker_index.hpp"
+#include "../golos.worker.snapshot/table_exporter.hpp"
 
 using namespace eosio;
 using namespace eosio::chain;
@@ -25,6 +30,8 @@ const asset app_token_supply = asset::from_string("1000000.000 APP");
 const asset app_fund_supply = asset::from_string("100.000 APP");
 const asset initial_user_supply = asset::from_string("10.000 APP");
 const asset proposal_deposit = asset::from_string("10.000 APP");
+// the tables of a pool are scoped by its token symbol code
+const name app_pool = name(app_token_supply.get_symbol().to_symbol_code().value);
 
 constexpr const char *long_text = "Lorem ipsum dolor sit amet, amet sint accusam sit te, te perfecto sadipscing vix, eam labore volumus dissentias ne. Est nonumy numquam fierent te. Te pri saperet disputando delicatissimi, pri semper ornatus ad. Paulo convenire argumentum cum te, te vix meis idque, odio tempor nostrum ius ad. Cu doctus mediocrem petentium his, eum sale errem timeam ne. Ludus debitis id qui, vix mucius antiopam ad. Facer signiferumque vis no, sale eruditi expetenda id ius.";
 constexpr size_t delegates_count = 21;
@@ -72,6 +79,16 @@ class base_contract
         return tester.push_action(move(act), uint64_t(signer));
     }
 
+    fc::variant get_action_data(const action &act)
+    {
+        return abi_ser.binary_to_variant(abi_ser.get_action_type(act.name), act.data, tester.abi_serializer_max_time);
+    }
+
+    vector<char> pack_row(const char *struct_name, const fc::variant &row)
+    {
+        return abi_ser.variant_to_binary(struct_name, row, tester.abi_serializer_max_time);
+    }
+
     fc::variant get_table_row(name table_name, const char *struct_name, name scope, uint64_t key)
     {
         vector<char> data = tester.get_row_by_account(code_account, scope, table_name, key);
@@ -111,6 +128,25 @@ class base_contract
 
         return objects;
     }
+
+    // primary keys of the table rows in the order of its secondary index number `index`
+    template <typename Index>
+    vector<uint64_t> get_secondary_order(name table, uint64_t scope, uint64_t index) {
+        const auto& db = tester.control->db();
+        const name index_table((table.value & 0xFFFFFFFFFFFFFFF0ULL) | index);
+        const auto* t_id = db.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( code_account, scope, index_table));
+        if(!static_cast<bool>(t_id)) {
+            return {};
+        }
+
+        const auto& idx = db.get_index<Index, chain::by_secondary>();
+        vector<uint64_t> keys;
+        for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id)); itr != idx.end() && itr->t_id == t_id->id; itr++) {
+            keys.push_back(itr->primary_key);
+        }
+
+        return keys;
+    }
 };
 
 class token_contract : public base_contract
@@ -163,6 +199,12 @@ class worker_contract : public base_contract
     {
     }
 
+    // the actions go to the APP pool unless the data names another one
+    base_tester::action_result push_action(const account_name &signer, const action_name &name, const variant_object &data)
+    {
+        return base_contract::push_action(signer, name, mvo()("pool", "APP")(data));
+    }
+
     fc::variant get_proposal(name scope, uint64_t id) {
         return base_contract::get_table_row(N(proposals), "proposal_t", scope, id);
     }
@@ -172,6 +214,14 @@ class worker_contract : public base_contract
         return proposal["state"].as_int64();
     }
 
+    fc::variant get_proposal_summary(name scope, uint64_t id) {
+        return base_contract::get_table_row(N(propsummary), "proposal_summary_t", scope, id);
+    }
+
+    fc::variant get_totals(name scope) {
+        return base_contract::get_table_row(N(totals), "totals_t", scope, N(totals));
+    }
+
     fc::variant get_state(name scope) {
         return base_contract::get_table_row(N(state), "state_t", scope, 0);
     }
@@ -184,6 +234,23 @@ class worker_contract : public base_contract
         return base_contract::get_table_row(N(proposalsc), "comment_t", scope, id);
     }
 
+    fc::variant get_text(name scope, const fc::variant &hash) {
+        for (auto &text : base_contract::get_table_rows(N(texts), "text_t", scope)) {
+            if (text["hash"].as_string() == hash.as_string()) {
+                return text;
+            }
+        }
+        return fc::variant();
+    }
+
+    fc::variant get_tspec_comment(name scope, uint64_t id) {
+        return base_contract::get_table_row(N(tspecappc), "comment_t", scope, id);
+    }
+
+    string get_proposal_comment_text(name scope, uint64_t id) {
+        return get_text(scope, get_proposal_comment(scope, id)["text_hash"])["text"].as_string();
+    }
+
     fc::variant get_fund(const name& scope, const name& fund_name) {
         return base_contract::get_table_row(N(funds), "fund_t", scope, fund_name);
     }
@@ -203,6 +270,38 @@ class worker_contract : public base_contract
     size_t get_proposal_votes_count(const uint64_t scope) {
         return base_contract::get_table_size(N(proposalsv), scope);
     }
+
+    size_t get_texts_count(const uint64_t scope) {
+        return base_contract::get_table_size(N(texts), scope);
+    }
+
+    fc::variant get_vote_root(name scope, uint64_t id) {
+        return base_contract::get_table_row(N(voteroots), "vote_root_t", scope, id);
+    }
+
+    size_t get_vote_nodes_count(const uint64_t scope) {
+        return base_contract::get_table_size(N(votenodes), scope);
+    }
+
+    size_t get_vote_roots_count(const uint64_t scope) {
+        return base_contract::get_table_size(N(voteroots), scope);
+    }
+
+    fc::variant get_weighted_tally(name scope, uint64_t id) {
+        return base_contract::get_table_row(N(tallies), "weighted_tally_t", scope, id);
+    }
+
+    fc::variant get_proxy(name scope, name account) {
+        return base_contract::get_table_row(N(proxies), "proxy_t", scope, account);
+    }
+
+    fc::variant get_account_usage(name scope, name account) {
+        return base_contract::get_table_row(N(usage), "usage_t", scope, account);
+    }
+
+    fc::variant get_proposal_usage(name scope, uint64_t id) {
+        return base_contract::get_table_row(N(propusage), "usage_t", scope, id);
+    }
 };
 
 class golos_worker_tester : public tester
@@ -256,7 +355,7 @@ class golos_worker_tester : public tester
         ASSERT_SUCCESS(token->open(worker_code_account, app_fund_supply.get_symbol().to_string(), worker_code_account));
         produce_blocks();
 
-        auto fund = worker->get_fund(worker_code_account, worker_code_account);
+        auto fund = worker->get_fund(app_pool, worker_code_account);
         BOOST_REQUIRE(!fund.is_null());
         BOOST_REQUIRE_EQUAL(fund["quantity"], app_fund_supply.to_string());
     }
@@ -274,7 +373,7 @@ class golos_worker_tester : public tester
 
         produce_blocks(1);
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), 1);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), 1);
         
         BOOST_TEST_MESSAGE("adding tspec");
         ASSERT_SUCCESS(worker->push_action(tspec_author, N(addtspec), mvo()
@@ -290,7 +389,7 @@ class golos_worker_tester : public tester
                 ("payments_count", 1)
                 ("payments_interval", 1))));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_APP);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_APP);
 
         ASSERT_SUCCESS(worker->push_action(tspec_author, N(addtspec), mvo()
             ("proposal_id", proposal_id)
@@ -304,7 +403,7 @@ class golos_worker_tester : public tester
                 ("payments_count", 2)
                 ("payments_interval", 1))));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_APP);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_APP);
 
         // vote for the 0 technical specification application
         for (size_t i = 0; i < delegates_51; i++)
@@ -318,9 +417,9 @@ class golos_worker_tester : public tester
                 ("comment", mvo()("text", "Lorem Ipsum"))));
         }
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_CREATE);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_CREATE);
         // if technical specification application was upvoted, `proposal_deposit` should be deposited from the application fund
-        BOOST_REQUIRE_EQUAL(worker->get_proposal(worker_code_account, proposal_id)["deposit"], proposal_deposit.to_string());
+        BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, proposal_id)["deposit"], proposal_deposit.to_string());
 
         /* ok,technical specification application has been choosen,
         now technical specification application author should publish
@@ -328,7 +427,7 @@ class golos_worker_tester : public tester
 
         BOOST_REQUIRE_EQUAL(worker->push_action(tspec_author, N(edittspec), mvo()
             ("tspec_app_id", tspec_app_id)
-            ("tspec", mvo()
+            ("patch", mvo()
                 ("text", long_text)
                 ("specification_cost", "10.000 APP")
                 ("specification_eta", 1)
@@ -337,26 +436,26 @@ class golos_worker_tester : public tester
                 ("payments_count", 1)
                 ("payments_interval", 1))), wasm_assert_msg("cost can't be modified"));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_CREATE);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_CREATE);
 
         ASSERT_SUCCESS(worker->push_action(tspec_author, N(edittspec), mvo()
             ("tspec_app_id", tspec_app_id)
-            ("tspec", mvo()
+            ("patch", mvo()
                 ("text", long_text)
-                ("specification_cost", "0.000 APP")
+                ("specification_cost", fc::variant())
                 ("specification_eta", 1)
-                ("development_cost", "0.000 APP")
+                ("development_cost", fc::variant())
                 ("development_eta", 1)
                 ("payments_count", 1)
                 ("payments_interval", 1))));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_CREATE);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_CREATE);
 
         ASSERT_SUCCESS(worker->push_action(tspec_author, N(startwork), mvo()
             ("proposal_id", proposal_id)
             ("worker", worker_account)));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_WORK);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_WORK);
 
         for (int i = 0; i < 5; i++) {
             ASSERT_SUCCESS(worker->push_action(worker_account, N(poststatus), mvo()
@@ -386,7 +485,7 @@ try
             ("title", "Proposal #1")
             ("description", "Description #1")));
         return;
-        auto proposal_row = worker->get_proposal(worker_code_account, proposal_id);
+        auto proposal_row = worker->get_proposal(app_pool, proposal_id);
         BOOST_REQUIRE_EQUAL(proposal_row["state"], STATE_TSPEC_APP);
         BOOST_REQUIRE_EQUAL(proposal_row["title"], "Proposal #1");
         BOOST_REQUIRE_EQUAL(proposal_row["description"], "Description #1");
@@ -395,20 +494,20 @@ try
         ASSERT_SUCCESS(worker->push_action(author_account, N(editpropos), mvo()
             ("proposal_id", proposal_id)
             ("title", "New Proposal #1")
-            ("description", "")));
+            ("description", fc::variant())));
 
         BOOST_REQUIRE_EQUAL(worker->push_action(author_account, N(editpropos), mvo()
             ("proposal_id", proposal_id)
-            ("title", "")
-            ("description", "")), wasm_assert_msg("invalid arguments"));
+            ("title", fc::variant())
+            ("description", fc::variant())), wasm_assert_msg("invalid arguments"));
 
-        proposal_row = worker->get_proposal(worker_code_account, proposal_id);
+        proposal_row = worker->get_proposal(app_pool, proposal_id);
         BOOST_REQUIRE_EQUAL(proposal_row["title"], "New Proposal #1");
 
         ASSERT_SUCCESS(worker->push_action(author_account, N(delpropos), mvo()
             ("proposal_id", proposal_id)));
 
-        proposal_row = worker->get_proposal(worker_code_account, proposal_id);
+        proposal_row = worker->get_proposal(app_pool, proposal_id);
         BOOST_REQUIRE(proposal_row.is_null());
     }
 }
@@ -446,7 +545,7 @@ try
             ("data", mvo()
                 ("text", "Duplicate comment"))), wasm_assert_msg("comment exists"));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_comment(worker_code_account, comment_id)["data"]["text"].as_string(), "Awesome!");
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_comment_text(app_pool, comment_id), "Awesome!");
 
         ASSERT_SUCCESS(worker->push_action(comment_author, N(editcomment), mvo()
             ("proposal_id", proposal_id)
@@ -461,11 +560,11 @@ try
             ("data", mvo()
                 ("text", ""))), wasm_assert_msg("nothing to change"));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_comment(worker_code_account, comment_id)["data"]["text"].as_string(), "Fine!");
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_comment_text(app_pool, comment_id), "Fine!");
     }
 
     // check get_proposal_comments_count value is equal to comments_count after creating/editing comments
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(worker_code_account), comments_count);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(app_pool), comments_count);
 
     for (uint64_t i = 0; i < comments_count; i++) {
         const uint64_t comment_id = i;
@@ -474,7 +573,7 @@ try
         ASSERT_SUCCESS(worker->push_action(comment_author, N(delcomment), mvo()
             ("comment_id", comment_id)));
 
-        BOOST_REQUIRE(worker->get_proposal_comment(worker_code_account, comment_id).is_null());
+        BOOST_REQUIRE(worker->get_proposal_comment(app_pool, comment_id).is_null());
 
         // ensure fail when deleting non-existing comment
         BOOST_REQUIRE_EQUAL(worker->push_action(comment_author, N(delcomment), mvo()
@@ -489,12 +588,191 @@ try
     }
 
     // check get_proposal_comments_count value is equal to 0 after deleting comments
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(worker_code_account), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(app_pool), 0);
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()
+        ("proposal_id", proposal_id)));
+
+    BOOST_REQUIRE(worker->get_proposal(app_pool, proposal_id).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(proposal_indexes, golos_worker_tester)
+try
+{
+    // the proposal ids go against the creation order
+    for (uint64_t i = 0; i < 3; i++) {
+        const uint64_t proposal_id = 2 - i;
+        ASSERT_SUCCESS(worker->push_action(members[i], N(addpropos), mvo()
+            ("proposal_id", proposal_id)
+            ("author", members[i])
+            ("title", boost::str(boost::format("Proposal #%d") % proposal_id))
+            ("description", "Description")));
+        produce_blocks(1);
+    }
+
+    BOOST_REQUIRE(worker->get_secondary_order<chain::index64_index>(N(proposals), app_pool, 0) ==
+                  vector<uint64_t>({2, 1, 0}));
+
+    // the proposals in the same state are ranged by id
+    BOOST_REQUIRE(worker->get_secondary_order<chain::index128_index>(N(proposals), app_pool, 1) ==
+                  vector<uint64_t>({0, 1, 2}));
+
+    // the comments of a proposal are ranged in the order of creation, whatever their ids
+    const vector<std::pair<uint64_t, uint64_t>> comments = {{0, 5}, {1, 3}, {0, 4}, {1, 1}, {0, 2}};
+    for (size_t i = 0; i < comments.size(); i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(addcomment), mvo()
+            ("proposal_id", comments[i].first)
+            ("comment_id", comments[i].second)
+            ("author", members[i])
+            ("data", mvo()
+                ("text", "Comment"))));
+        produce_blocks(1);
+    }
+
+    BOOST_REQUIRE(worker->get_secondary_order<chain::index128_index>(N(proposalsc), app_pool, 1) ==
+                  vector<uint64_t>({5, 4, 2, 3, 1}));
+
+    // the removed proposal leaves all the indexes
+    ASSERT_SUCCESS(worker->push_action(members[1], N(delpropos), mvo()
+        ("proposal_id", 1)));
+    BOOST_REQUIRE(worker->get_secondary_order<chain::index64_index>(N(proposals), app_pool, 0) ==
+                  vector<uint64_t>({2, 0}));
+    BOOST_REQUIRE_EQUAL(worker->get_secondary_order<chain::index128_index>(N(proposals), app_pool, 1).size(), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_secondary_order<chain::index64_index>(N(proposals), app_pool, 2).size(), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_secondary_order<chain::index64_index>(N(proposals), app_pool, 3).size(), 2);
+
+    // the proposal 0 has been stored before the version and the state, author and worker indexes
+    auto &db = control->mutable_db();
+    auto find_table = [&](name table) {
+        const auto *t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, table));
+        BOOST_REQUIRE(t_id != nullptr);
+        db.modify(*t_id, [](table_id_object &t) {
+            t.count--;
+        });
+        return t_id->id;
+    };
+    auto index_table = [](uint64_t index) {
+        return name((N(proposals).value & 0xFFFFFFFFFFFFFFF0ULL) | index);
+    };
+    const auto state_t_id = find_table(index_table(1));
+    db.remove(*db.find<index128_object, by_primary>(boost::make_tuple(state_t_id, 0)));
+    for (uint64_t index = 2; index < 4; index++) {
+        const auto t_id = find_table(index_table(index));
+        db.remove(*db.find<index64_object, by_primary>(boost::make_tuple(t_id, 0)));
+    }
+    const auto *proposals_t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, N(proposals)));
+    db.modify(db.get<key_value_object, by_scope_primary>(boost::make_tuple(proposals_t_id->id, 0)), [](key_value_object &obj) {
+        obj.value.resize(obj.value.size() - 1);
+    });
+    BOOST_REQUIRE(worker->get_secondary_order<chain::index128_index>(N(proposals), app_pool, 1) == vector<uint64_t>({2}));
+
+    // migrate stores it again with the entries
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(migrate), mvo()("max_rows", 100)));
+    BOOST_REQUIRE(worker->get_secondary_order<chain::index128_index>(N(proposals), app_pool, 1) == vector<uint64_t>({0, 2}));
+    BOOST_REQUIRE_EQUAL(worker->get_secondary_order<chain::index64_index>(N(proposals), app_pool, 2).size(), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_secondary_order<chain::index64_index>(N(proposals), app_pool, 3).size(), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["version"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["title"].as_string(), "Proposal #0");
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(text_store, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    constexpr uint64_t comments_count = 10;
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", long_text)));
+
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 1);
+
+    // the same text is stored only once and is shared by all comments
+    for (uint64_t i = 0; i < comments_count; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(addcomment), mvo()
+            ("proposal_id", proposal_id)
+            ("comment_id", i)
+            ("author", members[i])
+            ("data", mvo()
+                ("text", long_text))));
+    }
+
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 1);
+    auto text = worker->get_text(app_pool, worker->get_proposal_comment(app_pool, 0)["text_hash"]);
+    BOOST_REQUIRE_EQUAL(text["text"].as_string(), long_text);
+    BOOST_REQUIRE_EQUAL(text["refs"].as_uint64(), comments_count + 1);
+
+    // the text outlives the row that has added it, so it is billed to the contract
+    const auto &db = control->db();
+    const auto *t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, N(texts)));
+    BOOST_REQUIRE(t_id != nullptr);
+    BOOST_REQUIRE_EQUAL(db.get<key_value_object, by_scope_primary>(boost::make_tuple(t_id->id, text["id"].as_uint64())).payer, worker_code_account);
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(editcomment), mvo()
+        ("comment_id", 0)
+        ("data", mvo()
+            ("text", "Fine!"))));
+
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 2);
+
+    for (uint64_t i = 0; i < comments_count; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(delcomment), mvo()
+            ("comment_id", i)));
+    }
+
+    // the description is still referred by the proposal
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 1);
 
     ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()
         ("proposal_id", proposal_id)));
 
-    BOOST_REQUIRE(worker->get_proposal(worker_code_account, proposal_id).is_null());
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 0);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(hash_only_comments, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    const uint64_t tspec_app_id = 0;
+    const string comment_text = "Lorem Ipsum";
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+
+    ASSERT_SUCCESS(worker->push_action(members[1], N(addtspec), mvo()
+        ("proposal_id", proposal_id)
+        ("tspec_app_id", tspec_app_id)
+        ("author", members[1])
+        ("tspec", mvo()
+            ("text", "Technical specification")
+            ("specification_cost", "1.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "1.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))));
+
+    const size_t texts_count = worker->get_texts_count(app_pool);
+
+    ASSERT_SUCCESS(worker->push_action(delegates[0], N(approvetspec), mvo()
+        ("tspec_app_id", tspec_app_id)
+        ("author", delegates[0])
+        ("comment_id", 0)
+        ("comment", mvo()("text", comment_text))));
+
+    // approve comments keep only the hash and the size of the text
+    auto comment = worker->get_tspec_comment(app_pool, 0);
+    BOOST_REQUIRE_EQUAL(comment["text_hash"].as_string(), fc::sha256::hash(comment_text).str());
+    BOOST_REQUIRE_EQUAL(comment["text_size"].as_uint64(), comment_text.size());
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), texts_count);
 }
 FC_LOG_AND_RETHROW()
 
@@ -509,7 +787,7 @@ try
         ("title", "Proposal #1")
         ("description", "Description #1")));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(worker_code_account), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), 0);
 
     for (size_t i = 0; i < delegates.size(); i++)
     {
@@ -521,7 +799,7 @@ try
             ("positive", (i + 1) % 2)));
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(worker_code_account), delegates.size());
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), delegates.size());
 
     // revote with the same `positive` value
     for (size_t i = 0; i < delegates.size(); i++)
@@ -534,7 +812,7 @@ try
             ("positive", (i + 1) % 2)), wasm_assert_msg("the vote already exists"));
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(worker_code_account), delegates.size());
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), delegates.size());
 
     // revote with the different `positive` value
     for (size_t i = 0; i < delegates.size(); i++)
@@ -547,9 +825,9 @@ try
             ("positive", (i) % 2)));
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(worker_code_account), delegates.size());
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), delegates.size());
 
-    auto votes = worker->get_table_rows(N(proposalsv), "vote_t", worker_code_account);
+    auto votes = worker->get_table_rows(N(proposalsv), "vote_t", app_pool);
     BOOST_REQUIRE_EQUAL(delegates.size(), votes.size());
     // revote with the different `positive` value
     for (size_t i = 0; i < delegates.size(); i++)
@@ -563,7 +841,302 @@ try
     ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()
         ("proposal_id", proposal_id)));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(worker_code_account), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), 0);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(events, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+
+    auto trace = push_action(worker_code_account, N(addpropos), members[0], mvo()
+        ("pool", "APP")
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "Description #1"));
+
+    auto events = trace->action_traces.front().inline_traces;
+    BOOST_REQUIRE_EQUAL(events.size(), 1);
+    BOOST_REQUIRE_EQUAL(events[0].act.account, worker_code_account);
+    BOOST_REQUIRE_EQUAL(events[0].act.name, N(eventpropos));
+    auto event = worker->get_action_data(events[0].act);
+    BOOST_REQUIRE_EQUAL(event["pool"].as_string(), "APP");
+    BOOST_REQUIRE_EQUAL(event["proposal_id"].as_uint64(), proposal_id);
+    BOOST_REQUIRE_EQUAL(event["state"].as_uint64(), STATE_TSPEC_APP);
+
+    trace = push_action(worker_code_account, N(votepropos), delegates[0], mvo()
+        ("pool", "APP")
+        ("proposal_id", proposal_id)
+        ("voter", delegates[0])
+        ("positive", 0));
+
+    events = trace->action_traces.front().inline_traces;
+    BOOST_REQUIRE_EQUAL(events.size(), 1);
+    BOOST_REQUIRE_EQUAL(events[0].act.name, N(eventvote));
+    event = worker->get_action_data(events[0].act);
+    BOOST_REQUIRE_EQUAL(event["votes_table"].as_string(), "proposalsv");
+    BOOST_REQUIRE_EQUAL(event["voter"].as_string(), delegates[0].to_string());
+    BOOST_REQUIRE_EQUAL(event["vote"].as_int64(), -1);
+
+    // the deleted proposal is reported with its deposit refunded, the fund with the refund added
+    ASSERT_SUCCESS(token->transfer(members[0], worker_code_account, asset::from_string("10.000 APP"), members[0].to_string()));
+    ASSERT_SUCCESS(worker->push_action(members[0], N(setfund), mvo()
+        ("proposal_id", proposal_id)
+        ("fund_name", members[0])
+        ("quantity", "10.000 APP")));
+    trace = push_action(worker_code_account, N(delpropos), members[0], mvo()
+        ("pool", "APP")
+        ("proposal_id", proposal_id));
+
+    map<name, fc::variant> last_events;
+    for (const auto &inline_trace : trace->action_traces.front().inline_traces) {
+        last_events[inline_trace.act.name] = worker->get_action_data(inline_trace.act);
+    }
+    BOOST_REQUIRE_EQUAL(last_events[N(eventpropos)]["state"].as_uint64(), 0);
+    BOOST_REQUIRE_EQUAL(last_events[N(eventpropos)]["deposit"].as_string(), "0.000 APP");
+    BOOST_REQUIRE_EQUAL(last_events[N(eventfund)]["fund_name"].as_string(), members[0].to_string());
+    BOOST_REQUIRE_EQUAL(last_events[N(eventfund)]["quantity"].as_string(), "10.000 APP");
+
+    // events can be sent only by the contract itself
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(eventfund), mvo()
+        ("fund_name", members[0])
+        ("quantity", "1.000 APP")), error("missing authority of app.worker"));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(pools, golos_worker_tester)
+try
+{
+    const asset gls_supply = asset::from_string("1000.000 GLS");
+    const name gls_pool = name(gls_supply.get_symbol().to_symbol_code().value);
+
+    ASSERT_SUCCESS(token->create(token_code_account, gls_supply));
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(createpool), mvo()("token_symbol", app_token_supply.get_symbol())),
+        wasm_assert_msg("workers pool is already initialized for the specified app domain"));
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(createpool), mvo()("token_symbol", gls_supply.get_symbol())));
+
+    // both pools count their proposals from zero
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", 0)
+        ("author", members[0])
+        ("title", "APP proposal")
+        ("description", "")));
+    ASSERT_SUCCESS(worker->push_action(members[1], N(addpropos), mvo()
+        ("pool", "GLS")
+        ("proposal_id", 0)
+        ("author", members[1])
+        ("title", "GLS proposal")
+        ("description", "")));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["author"].as_string(), members[0].to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(gls_pool, 0)["author"].as_string(), members[1].to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(worker_code_account), 0);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[2], N(addpropos), mvo()
+        ("pool", "XYZ")
+        ("proposal_id", 0)
+        ("author", members[2])
+        ("title", "XYZ proposal")
+        ("description", "")),
+        wasm_assert_msg("workers pool has not been created for the specified app domain"));
+
+    // a transfer goes to the pool of its token
+    ASSERT_SUCCESS(token->issue(token_code_account, worker_code_account, asset::from_string("5.000 GLS"), worker_code_account.to_string()));
+    BOOST_REQUIRE_EQUAL(worker->get_fund(gls_pool, worker_code_account)["quantity"], "5.000 GLS");
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], app_fund_supply.to_string());
+
+    // the tokens of a token without a pool aren't kept by the contract
+    ASSERT_SUCCESS(token->create(token_code_account, asset::from_string("1000.000 XYZ")));
+    BOOST_REQUIRE_EQUAL(token->issue(token_code_account, worker_code_account, asset::from_string("5.000 XYZ"), worker_code_account.to_string()),
+        wasm_assert_msg("workers pool has not been created for the specified app domain"));
+
+    ASSERT_SUCCESS(worker->push_action(delegates[0], N(votepropos), mvo()
+        ("pool", "GLS")
+        ("proposal_id", 0)
+        ("voter", delegates[0])
+        ("positive", 1)));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(gls_pool), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), 0);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(indexer, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    const uint64_t tspec_app_id = 0;
+    const string feed_path = "golos.worker.indexer.traces.jsonl";
+
+    // record a traces feed of the contract
+    std::ofstream feed(feed_path);
+    auto record = [&](const transaction_trace_ptr &trace) {
+        for (const auto &action_trace : trace->action_traces) {
+            feed << fc::json::to_string(action_trace) << std::endl;
+        }
+    };
+
+    record(push_action(worker_code_account, N(addpropos), members[0], mvo()
+        ("pool", "APP")
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+
+    record(push_action(worker_code_account, N(addcomment), members[1], mvo()
+        ("pool", "APP")
+        ("proposal_id", proposal_id)
+        ("comment_id", 0)
+        ("author", members[1])
+        ("data", mvo()("text", "Lorem Ipsum"))));
+
+    record(push_action(worker_code_account, N(addtspec), members[2], mvo()
+        ("pool", "APP")
+        ("proposal_id", proposal_id)
+        ("tspec_app_id", tspec_app_id)
+        ("author", members[2])
+        ("tspec", mvo()
+            ("text", "Technical specification")
+            ("specification_cost", "1.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "1.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))));
+
+    for (size_t i = 0; i < delegates_51; i++) {
+        record(push_action(worker_code_account, N(approvetspec), delegates[i], mvo()
+            ("pool", "APP")
+            ("tspec_app_id", tspec_app_id)
+            ("author", delegates[i])
+            ("comment_id", 0)
+            ("comment", mvo()("text", i == 0 ? "Looks fine" : ""))));
+    }
+    feed.close();
+
+    golos::indexer::worker_index index(worker_code_account, "APP", fc::json::from_string(contracts::golos_worker_abi().data()).as<abi_def>());
+    BOOST_REQUIRE_EQUAL(index.apply_file(feed_path), 3 + delegates_51);
+
+    const auto *proposal = index.find_proposal(proposal_id);
+    BOOST_REQUIRE(proposal != nullptr);
+    BOOST_REQUIRE_EQUAL(proposal->state, worker->get_proposal_state(app_pool, proposal_id));
+    BOOST_REQUIRE_EQUAL(proposal->tspec_id, tspec_app_id);
+    BOOST_REQUIRE_EQUAL(proposal->deposit.to_string(), worker->get_proposal(app_pool, proposal_id)["deposit"].as_string());
+
+    auto by_state = index.proposals_by_state(STATE_TSPEC_CREATE);
+    BOOST_REQUIRE_EQUAL(std::distance(by_state.first, by_state.second), 1);
+    auto by_author = index.proposals_by_author(members[0]);
+    BOOST_REQUIRE_EQUAL(std::distance(by_author.first, by_author.second), 1);
+
+    auto tspecs = index.tspecs_by_proposal(proposal_id);
+    BOOST_REQUIRE_EQUAL(std::distance(tspecs.first, tspecs.second), 1);
+    BOOST_REQUIRE_EQUAL(tspecs.first->author, members[2]);
+
+    auto votes = index.votes(N(proposalstsv), tspec_app_id);
+    BOOST_REQUIRE_EQUAL(std::distance(votes.first, votes.second), delegates_51);
+
+    auto comments = index.comments(N(proposalsc), proposal_id);
+    BOOST_REQUIRE_EQUAL(std::distance(comments.first, comments.second), 1);
+
+    // only the approval with a text leaves a comment, its ID doesn't clash with the proposal comment
+    comments = index.comments(N(tspecappc), tspec_app_id);
+    BOOST_REQUIRE_EQUAL(std::distance(comments.first, comments.second), 1);
+    BOOST_REQUIRE_EQUAL(comments.first->author, delegates[0]);
+    BOOST_REQUIRE_EQUAL(index.comments().size(), 2);
+
+    // the fund movement caused by the tspec approval
+    BOOST_REQUIRE(index.fund(worker_code_account).valid());
+    BOOST_REQUIRE_EQUAL(index.fund(worker_code_account)->to_string(), worker->get_fund(app_pool, worker_code_account)["quantity"].as_string());
+
+    // full-text search over the titles, descriptions, tspecs and comments
+    auto matches = index.search("lorem", 10);
+    BOOST_REQUIRE_EQUAL(matches.size(), 1);
+    BOOST_REQUIRE_EQUAL(matches[0].kind, golos::indexer::TEXT_COMMENT);
+    BOOST_REQUIRE_EQUAL(matches[0].id, 0);
+
+    matches = index.search("TECHNICAL specification", 10);
+    BOOST_REQUIRE_EQUAL(matches.size(), 1);
+    BOOST_REQUIRE_EQUAL(matches[0].kind, golos::indexer::TEXT_TSPEC);
+
+    matches = index.search("fine", 10);
+    BOOST_REQUIRE_EQUAL(matches.size(), 1);
+    BOOST_REQUIRE_EQUAL(matches[0].kind, golos::indexer::TEXT_TSPEC_COMMENT);
+
+    BOOST_REQUIRE_EQUAL(index.search("proposal description", 10).size(), 2);
+    BOOST_REQUIRE(index.search("nothing", 10).empty());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(columnar_snapshot, golos_worker_tester)
+try
+{
+    add_proposal(0, members[0], members[1], members[2]);
+    add_proposal(1, members[3], members[4], members[5]);
+
+    golos::snapshot::table_exporter exporter(fc::json::from_string(contracts::golos_worker_abi().data()).as<abi_def>());
+    auto export_table = [&](name table) {
+        const string path = "golos.worker.snapshot." + table.to_string() + ".col";
+        exporter.export_rows(table, golos::snapshot::read_rows(control->db(), worker_code_account, app_pool, table)).write(path);
+        return path;
+    };
+
+    golos::snapshot::table_reader proposals(export_table(N(proposals)));
+    auto proposal_rows = worker->get_table_rows(N(proposals), "proposal_t", app_pool);
+    BOOST_REQUIRE_EQUAL(proposals.rows(), proposal_rows.size());
+
+    const uint64_t *ids = proposals.values<uint64_t>("id");
+    const uint8_t *states = proposals.values<uint8_t>("state");
+    const int64_t *deposits = proposals.values<int64_t>("deposit.amount");
+    const uint32_t *created = proposals.values<uint32_t>("created");
+    for (size_t i = 0; i < proposal_rows.size(); i++) {
+        const auto &row = proposal_rows[i];
+        BOOST_REQUIRE_EQUAL(ids[i], row["id"].as_uint64());
+        BOOST_REQUIRE_EQUAL(states[i], row["state"].as_uint64());
+        BOOST_REQUIRE_EQUAL(deposits[i], row["deposit"].as<asset>().get_amount());
+        BOOST_REQUIRE_EQUAL(created[i], row["created"].as<block_timestamp_type>().slot);
+        BOOST_REQUIRE_EQUAL(name(proposals.values<uint64_t>("author")[i]), row["author"].as<name>());
+
+        auto title = proposals.text("title", i);
+        BOOST_REQUIRE_EQUAL(string(title.first, title.second), row["title"].as_string());
+    }
+
+    // nested structs are flattened
+    golos::snapshot::table_reader tspecs(export_table(N(tspecs)));
+    auto tspec_rows = worker->get_table_rows(N(tspecs), "tspec_app_t", app_pool);
+    BOOST_REQUIRE_EQUAL(tspecs.rows(), tspec_rows.size());
+    for (size_t i = 0; i < tspec_rows.size(); i++) {
+        const auto &data = tspec_rows[i]["data"];
+        BOOST_REQUIRE_EQUAL(tspecs.values<int64_t>("data.development_cost.amount")[i], data["development_cost"].as<asset>().get_amount());
+        BOOST_REQUIRE_EQUAL(tspecs.values<uint16_t>("data.payments_count")[i], data["payments_count"].as_uint64());
+        BOOST_REQUIRE_EQUAL(tspecs.text("data.text", i).second, 0);
+    }
+
+    golos::snapshot::table_reader funds(export_table(N(funds)));
+    BOOST_REQUIRE_EQUAL(funds.rows(), 1);
+    BOOST_REQUIRE_EQUAL(name(funds.values<uint64_t>("owner")[0]), worker_code_account);
+    BOOST_REQUIRE_EQUAL(funds.values<int64_t>("quantity.amount")[0],
+        worker->get_fund(app_pool, worker_code_account)["quantity"].as<asset>().get_amount());
+
+    golos::snapshot::table_reader votes(export_table(N(proposalstsv)));
+    BOOST_REQUIRE_EQUAL(votes.rows(), worker->get_table_size(N(proposalstsv), app_pool));
+
+    // the optional checkpoint of a movement gets a column telling the rows that have it
+    golos::snapshot::table_reader journal(export_table(N(journal)));
+    auto journal_rows = worker->get_table_rows(N(journal), "movement_t", app_pool);
+    BOOST_REQUIRE_EQUAL(journal.rows(), journal_rows.size());
+    BOOST_REQUIRE_GT(journal_rows.size(), 1);
+    for (size_t i = 0; i < journal_rows.size(); i++) {
+        const auto &checkpoint = journal_rows[i]["checkpoint"];
+        BOOST_REQUIRE_EQUAL(journal.values<uint8_t>("checkpoint?")[i], checkpoint.is_null() ? 0 : 1);
+        BOOST_REQUIRE_EQUAL(journal.values<int64_t>("checkpoint.deposited.amount")[i],
+                            checkpoint.is_null() ? 0 : checkpoint["deposited"].as<asset>().get_amount());
+    }
+    BOOST_REQUIRE_EQUAL(journal.values<uint8_t>("checkpoint?")[0], 1);
+
+    // every table of the ABI can be exported, as the snapshot tool does
+    for (const auto &table : exporter.abi().tables) {
+        export_table(table.name);
+    }
 }
 FC_LOG_AND_RETHROW()
 
@@ -584,7 +1157,7 @@ try
             ("description", "Description #1"))
         );
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_APP);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_APP);
 
         for (uint64_t j = 0; j < 1; j++) {
             const uint64_t tspec_app_id = 100 * i + j;
@@ -604,13 +1177,15 @@ try
 
             ASSERT_SUCCESS(worker->push_action(tspec_author, N(addtspec), tspec_app));
 
-            auto tspec_row = worker->get_tspec(worker_code_account, tspec_app_id);
+            auto tspec_row = worker->get_tspec(app_pool, tspec_app_id);
             BOOST_REQUIRE_EQUAL(tspec_row["id"].as_int64(), tspec_app_id);
-            REQUIRE_MATCHING_OBJECT(tspec_row["data"], tspec_app["tspec"]);
+            // the text is moved to the text store, `data.text` is kept empty
+            REQUIRE_MATCHING_OBJECT(tspec_row["data"], mvo(tspec_app["tspec"].get_object())("text", ""));
+            BOOST_REQUIRE_EQUAL(worker->get_text(app_pool, tspec_row["text_hash"])["text"].as_string(), "Technical specification");
 
             ASSERT_SUCCESS(worker->push_action(tspec_author, N(edittspec), mvo()
                 ("tspec_app_id", tspec_app_id)
-                ("tspec", mvo()
+                ("patch", mvo()
                     ("text", "Technical specification")
                     ("specification_cost", "2.000 APP")
                     ("specification_eta", 2)
@@ -619,9 +1194,27 @@ try
                     ("payments_count", 2)
                     ("payments_interval", 2))));
 
-            tspec_row = worker->get_tspec(worker_code_account, tspec_app_id);
+            tspec_row = worker->get_tspec(app_pool, tspec_app_id);
             BOOST_REQUIRE_EQUAL(tspec_row["data"]["specification_cost"].as_string(), "2.000 APP");
             BOOST_REQUIRE_EQUAL(tspec_row["data"]["development_cost"].as_string(), "2.000 APP");
+            BOOST_REQUIRE_EQUAL(tspec_row["data"]["payments_interval"].as_uint64(), 2);
+
+            // only the specified fields are modified, zero cost can be set on purpose
+            ASSERT_SUCCESS(worker->push_action(tspec_author, N(edittspec), mvo()
+                ("tspec_app_id", tspec_app_id)
+                ("patch", mvo()
+                    ("text", fc::variant())
+                    ("specification_cost", "0.000 APP")
+                    ("specification_eta", fc::variant())
+                    ("development_cost", fc::variant())
+                    ("development_eta", fc::variant())
+                    ("payments_count", fc::variant())
+                    ("payments_interval", fc::variant()))));
+
+            tspec_row = worker->get_tspec(app_pool, tspec_app_id);
+            BOOST_REQUIRE_EQUAL(tspec_row["data"]["specification_cost"].as_string(), "0.000 APP");
+            BOOST_REQUIRE_EQUAL(tspec_row["data"]["development_cost"].as_string(), "2.000 APP");
+            BOOST_REQUIRE_EQUAL(tspec_row["data"]["specification_eta"].as_uint64(), 2);
 
             const name& approver = delegates[0];
             ASSERT_SUCCESS(worker->push_action(approver, N(approvetspec), mvo()
@@ -637,13 +1230,13 @@ try
             ASSERT_SUCCESS(worker->push_action(tspec_author, N(deltspec), mvo()
                 ("tspec_app_id", tspec_app_id)));
 
-            BOOST_REQUIRE(worker->get_tspec(worker_code_account, tspec_app_id).is_null());
+            BOOST_REQUIRE(worker->get_tspec(app_pool, tspec_app_id).is_null());
         }
 
         ASSERT_SUCCESS(worker->push_action(proposal_author, N(delpropos), mvo()
             ("proposal_id", proposal_id)));
 
-        BOOST_REQUIRE(worker->get_proposal(worker_code_account, proposal_id).is_null());
+        BOOST_REQUIRE(worker->get_proposal(app_pool, proposal_id).is_null());
     }
 }
 FC_LOG_AND_RETHROW()
@@ -664,9 +1257,9 @@ try
         ("description", "Description #1"))
     );
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(worker_code_account), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(app_pool), 1);
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_APP);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_APP);
 
     for (uint64_t j = 0; j < relative_rows_count; j++) {
         const uint64_t tspec_app_id = 100 + j;
@@ -695,15 +1288,15 @@ try
         ASSERT_SUCCESS(worker->push_action(tspec_author, N(addtspec), tspec_app));
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(worker_code_account), relative_rows_count);
-    BOOST_REQUIRE_EQUAL(worker->get_tspecs_count(worker_code_account), relative_rows_count);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(app_pool), relative_rows_count);
+    BOOST_REQUIRE_EQUAL(worker->get_tspecs_count(app_pool), relative_rows_count);
 
     ASSERT_SUCCESS(worker->push_action(proposal_author, N(delpropos), mvo()
         ("proposal_id", proposal_id)));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(worker_code_account), 0);
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(worker_code_account), 0);
-    BOOST_REQUIRE_EQUAL(worker->get_tspecs_count(worker_code_account), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(app_pool), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(app_pool), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_tspecs_count(app_pool), 0);
 
 }
 FC_LOG_AND_RETHROW()
@@ -737,7 +1330,7 @@ try
             ("comment", mvo()
                 ("text", long_text))));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_DELEGATES_REVIEW);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_DELEGATES_REVIEW);
 
         for (size_t i = 0; i < delegates.size(); i++) {
             const name &delegate = delegates[i];
@@ -749,18 +1342,25 @@ try
                 ("comment", mvo()("text", "Lorem Ipsum"))));
         }
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_PAYMENT);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_PAYMENT);
 
         ASSERT_SUCCESS(worker->push_action(worker_account, N(withdraw), mvo()
             ("proposal_id", proposal_id)));
 
-        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_CLOSED);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_CLOSED);
 
         auto worker_balance = token->get_account(worker_account, "3,APP");
         REQUIRE_MATCHING_OBJECT(worker_balance, mvo()("balance", "15.000 APP"));
 
         auto author_balance = token->get_account(tspec_author, "3,APP");
         REQUIRE_MATCHING_OBJECT(author_balance, mvo()("balance", "15.000 APP"));
+
+        // the contract balance is matched by the running totals without scanning the proposals
+        auto totals = worker->get_totals(app_pool);
+        const asset contract_balance = token->get_account(worker_code_account, "3,APP")["balance"].as<asset>();
+        BOOST_REQUIRE_EQUAL(totals["funded"].as<asset>() - totals["paid"].as<asset>(), contract_balance);
+        BOOST_REQUIRE_EQUAL(totals["deposited"].as<asset>(), asset::from_string("0.000 APP"));
+        BOOST_REQUIRE_EQUAL(worker->get_table_size(N(journal), app_pool), totals["movements"].as_uint64());
     }
 }
 FC_LOG_AND_RETHROW()
@@ -780,7 +1380,7 @@ try
         ("title", "Proposal #1")
         ("description", "Description #1")));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_APP);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_APP);
 
     ASSERT_SUCCESS(token->transfer(sponsor_account, worker_code_account, asset::from_string("10.000 APP"), sponsor_account.to_string()));
     ASSERT_SUCCESS(worker->push_action(sponsor_account, N(setfund), mvo()
@@ -829,18 +1429,18 @@ try
     }
 
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_TSPEC_CREATE);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_CREATE);
 
     /* ok,technical specification application has been choosen,
     now technical specification application author should publish
     a final technical specification */
     ASSERT_SUCCESS(worker->push_action(author_account, N(edittspec), mvo()
         ("tspec_app_id", tspec_app_id)
-        ("tspec", mvo()
+        ("patch", mvo()
             ("text", long_text)
-            ("specification_cost", "0.000 APP")
+            ("specification_cost", fc::variant())
             ("specification_eta", 1)
-            ("development_cost", "0.000 APP")
+            ("development_cost", fc::variant())
             ("development_eta", 1)
             ("payments_count", 1)
             ("payments_interval", 1))));
@@ -850,7 +1450,7 @@ try
         ("worker", worker_account.to_string())));
 
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_WORK);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_WORK);
 
     for (int i = 0; i < 5; i++) {
         ASSERT_SUCCESS(worker->push_action(worker_account, N(poststatus), mvo()
@@ -867,7 +1467,7 @@ try
             ("text", long_text))));
 
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_DELEGATES_REVIEW);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_DELEGATES_REVIEW);
 
     {
         int i = 0;
@@ -883,12 +1483,12 @@ try
         }
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_PAYMENT);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_PAYMENT);
 
     ASSERT_SUCCESS(worker->push_action(worker_account, N(withdraw), mvo()
         ("proposal_id", proposal_id)));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_CLOSED);
 
     auto sponsor_balance = token->get_account(sponsor_account, "3,APP");
     REQUIRE_MATCHING_OBJECT(sponsor_balance, mvo()("balance", "0.000 APP"));
@@ -901,6 +1501,51 @@ try
 }
 FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(transfer_memo, golos_worker_tester)
+try
+{
+    name sponsor_account = members[0];
+    uint64_t proposal_id = 1;
+
+    ASSERT_SUCCESS(worker->push_action(members[1], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[1])
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+
+    // a sponsor can top up only its own fund
+    BOOST_REQUIRE_EQUAL(token->transfer(sponsor_account, worker_code_account, asset::from_string("1.000 APP"), "fund:" + members[2].to_string()),
+                        wasm_assert_msg("the memo can name only the fund of the sender"));
+    ASSERT_SUCCESS(token->transfer(sponsor_account, worker_code_account, asset::from_string("1.000 APP"), "fund:" + sponsor_account.to_string()));
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, sponsor_account)["quantity"], "1.000 APP");
+
+    BOOST_REQUIRE_EQUAL(token->transfer(sponsor_account, worker_code_account, asset::from_string("5.000 APP"), "proposal:2"),
+                        wasm_assert_msg("proposal has not been found"));
+    BOOST_REQUIRE_EQUAL(token->transfer(sponsor_account, worker_code_account, asset::from_string("5.000 APP"), "proposal:1a"),
+                        wasm_assert_msg("invalid proposal id in the memo"));
+
+    // the proposal stored before the version grows in the notification, the author can't be billed there
+    auto &db = control->mutable_db();
+    const auto *t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, N(proposals)));
+    BOOST_REQUIRE(t_id != nullptr);
+    const auto &proposal_row = db.get<key_value_object, by_scope_primary>(boost::make_tuple(t_id->id, proposal_id));
+    db.modify(proposal_row, [](key_value_object &obj) {
+        obj.value.resize(obj.value.size() - 1);
+    });
+
+    // the transfer is credited to the sponsor's fund and deposited to the proposal at once
+    ASSERT_SUCCESS(token->transfer(sponsor_account, worker_code_account, asset::from_string("5.000 APP"), "proposal:1"));
+    auto proposal = worker->get_proposal(app_pool, proposal_id);
+    BOOST_REQUIRE_EQUAL(proposal["deposit"], "5.000 APP");
+    BOOST_REQUIRE_EQUAL(proposal["fund_name"].as<name>(), sponsor_account);
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, sponsor_account)["quantity"], "1.000 APP");
+    BOOST_REQUIRE_EQUAL(db.get<key_value_object, by_scope_primary>(boost::make_tuple(t_id->id, proposal_id)).payer, worker_code_account);
+
+    BOOST_REQUIRE_EQUAL(token->transfer(sponsor_account, worker_code_account, asset::from_string("5.000 APP"), "proposal:1"),
+                        wasm_assert_msg("fund is already deposited"));
+}
+FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(developed_feature, golos_worker_tester)
 try
 {
@@ -929,7 +1574,10 @@ try
             ("text", long_text))
         ));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_DELEGATES_REVIEW);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_DELEGATES_REVIEW);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(author_account, N(delpropos), mvo()
+        ("proposal_id", proposal_id)), wasm_assert_code(golos::proposal_rules::invalid_state_code(golos::proposal_rules::ACTION_DELPROPOS)));
 
     int i = 0;
     for (const auto &account : delegates) {
@@ -942,14 +1590,14 @@ try
         i++;
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_PAYMENT);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_PAYMENT);
 
     for (int i = 0; i < payments_count; i++) {
         ASSERT_SUCCESS(worker->push_action(worker_account, N(withdraw), mvo()
             ("proposal_id", 1)));
     }
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_CLOSED);
 
    auto worker_balance = token->get_account(worker_account, "3,APP");
    REQUIRE_MATCHING_OBJECT(worker_balance, mvo()("balance", "15.000 APP"));
@@ -959,6 +1607,1089 @@ try
 }
 FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(proposal_expiry, golos_worker_tester)
+try
+{
+    // the proposal 0 is at work, the proposal 1 waits for the tspec applications approval
+    add_proposal(0, members[0], members[1], members[2]);
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(addpropos), mvo()
+        ("proposal_id", 1)
+        ("author", members[3])
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+
+    ASSERT_SUCCESS(worker->push_action(members[4], N(addtspec), mvo()
+        ("proposal_id", 1)
+        ("tspec_app_id", 100)
+        ("author", members[4])
+        ("tspec", mvo()
+            ("text", "Technical specification")
+            ("specification_cost", "1.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "1.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))));
+
+    // the application of the proposal 2 is selected, but the work never starts
+    ASSERT_SUCCESS(worker->push_action(members[6], N(addpropos), mvo()
+        ("proposal_id", 2)
+        ("author", members[6])
+        ("title", "Proposal #2")
+        ("description", "Description #2")));
+
+    ASSERT_SUCCESS(worker->push_action(members[7], N(addtspec), mvo()
+        ("proposal_id", 2)
+        ("tspec_app_id", 200)
+        ("author", members[7])
+        ("tspec", mvo()
+            ("text", "Technical specification")
+            ("specification_cost", "1.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "1.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))));
+
+    for (size_t i = 0; i < delegates_51; i++) {
+        ASSERT_SUCCESS(worker->push_action(delegates[i], N(approvetspec), mvo()
+            ("tspec_app_id", 200)
+            ("author", delegates[i])
+            ("comment_id", 200 + i)
+            ("comment", mvo()("text", ""))));
+    }
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, 2), STATE_TSPEC_CREATE);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[5], N(sweep), mvo()
+        ("max_count", 10)), wasm_assert_msg("nothing to sweep"));
+
+    produce_block(fc::days(7) + fc::seconds(10));
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[5], N(sweep), mvo()
+            ("max_count", 1)));
+    }
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[5], N(sweep), mvo()
+        ("max_count", 1)), wasm_assert_msg("nothing to sweep"));
+
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, 0), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, 1), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, 2), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(deadlines), app_pool), 0);
+
+    // the deposit is refunded, the applications of the expired proposal are reclaimed
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], app_fund_supply.to_string());
+    BOOST_REQUIRE(worker->get_tspec(app_pool, 100).is_null());
+    BOOST_REQUIRE(!worker->get_tspec(app_pool, 0).is_null());
+    BOOST_REQUIRE(!worker->get_tspec(app_pool, 200).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(tspec_reclaim, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    const name &loser_author = members[1];
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+
+    const int64_t ram_usage = control->get_resource_limits_manager().get_account_ram_usage(loser_author);
+
+    for (uint64_t tspec_app_id = 0; tspec_app_id < 3; tspec_app_id++) {
+        ASSERT_SUCCESS(worker->push_action(tspec_app_id == 0 ? members[2] : loser_author, N(addtspec), mvo()
+            ("proposal_id", proposal_id)
+            ("tspec_app_id", tspec_app_id)
+            ("author", tspec_app_id == 0 ? members[2] : loser_author)
+            ("tspec", mvo()
+                ("text", boost::str(boost::format("Technical specification #%d") % tspec_app_id))
+                ("specification_cost", "1.000 APP")
+                ("specification_eta", 1)
+                ("development_cost", "1.000 APP")
+                ("development_eta", 1)
+                ("payments_count", 1)
+                ("payments_interval", 1))));
+    }
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(reclaimtspec), mvo()
+        ("proposal_id", proposal_id)
+        ("max_rows", 10)), wasm_assert_code(golos::proposal_rules::invalid_state_code(golos::proposal_rules::ACTION_RECLAIMTSPEC)));
+
+    // the losers get an approval and a comment short of the selection from each delegate
+    uint64_t comment_id = 0;
+    for (uint64_t tspec_app_id = 1; tspec_app_id < 3; tspec_app_id++) {
+        for (size_t i = 0; i + 1 < delegates_51; i++) {
+            ASSERT_SUCCESS(worker->push_action(delegates[i], N(approvetspec), mvo()
+                ("tspec_app_id", tspec_app_id)
+                ("author", delegates[i])
+                ("comment_id", comment_id++)
+                ("comment", mvo()("text", "Lorem Ipsum"))));
+        }
+    }
+
+    for (size_t i = 0; i < delegates_51; i++) {
+        ASSERT_SUCCESS(worker->push_action(delegates[i], N(approvetspec), mvo()
+            ("tspec_app_id", 0)
+            ("author", delegates[i])
+            ("comment_id", comment_id++)
+            ("comment", mvo()("text", ""))));
+    }
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_TSPEC_CREATE);
+
+    // the selection erases only a part of the losers' rows, the rest is left to reclaimtspec
+    BOOST_REQUIRE_EQUAL(worker->get_tspecs_count(app_pool), 2);
+
+    ASSERT_SUCCESS(worker->push_action(members[5], N(reclaimtspec), mvo()
+        ("proposal_id", proposal_id)
+        ("max_rows", 100)));
+
+    BOOST_REQUIRE_EQUAL(worker->get_tspecs_count(app_pool), 1);
+    BOOST_REQUIRE(!worker->get_tspec(app_pool, 0).is_null());
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(proposalstsv), app_pool), delegates_51);
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(tspecappc), app_pool), 0);
+
+    // the rows are reimbursed to their payers
+    BOOST_REQUIRE_EQUAL(control->get_resource_limits_manager().get_account_ram_usage(loser_author), ram_usage);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[5], N(reclaimtspec), mvo()
+        ("proposal_id", proposal_id)
+        ("max_rows", 100)), wasm_assert_msg("nothing to reclaim"));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(proposal_summary, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    add_proposal(proposal_id, members[0], members[1], members[2]);
+
+    for (size_t i = 3; i < 6; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(votepropos), mvo()
+            ("proposal_id", proposal_id)
+            ("voter", members[i])
+            ("positive", i % 2)));
+    }
+    // the revote moves the vote between the counters
+    ASSERT_SUCCESS(worker->push_action(members[3], N(votepropos), mvo()
+        ("proposal_id", proposal_id)
+        ("voter", members[3])
+        ("positive", 0)));
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(addcomment), mvo()
+        ("proposal_id", proposal_id)
+        ("comment_id", 1000)
+        ("author", members[3])
+        ("data", mvo()
+            ("text", "Awesome!"))));
+
+    auto summary = worker->get_proposal_summary(app_pool, proposal_id);
+    BOOST_REQUIRE(!summary.is_null());
+    BOOST_REQUIRE_EQUAL(summary["state"].as_int64(), STATE_WORK);
+    BOOST_REQUIRE_EQUAL(summary["tspec_id"].as_uint64(), proposal_id * 100);
+    // the losing application has been reclaimed on the selection
+    BOOST_REQUIRE_EQUAL(summary["tspecs_count"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(summary["positive_votes"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(summary["negative_votes"].as_uint64(), 2);
+    BOOST_REQUIRE_EQUAL(summary["comments_count"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(summary["tspec_comments_count"].as_uint64(), delegates_51);
+    BOOST_REQUIRE_EQUAL(summary["status_comments_count"].as_uint64(), 5);
+
+    // a recount from the tables gives the same summary
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[3], N(syncsummary), mvo()
+        ("proposal_id", proposal_id)), error("missing authority of app.worker"));
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(syncsummary), mvo()
+        ("proposal_id", proposal_id)));
+    BOOST_REQUIRE_EQUAL(fc::json::to_string(worker->get_proposal_summary(app_pool, proposal_id)), fc::json::to_string(summary));
+
+    ASSERT_SUCCESS(worker->push_action(members[2], N(cancelwork), mvo()
+        ("proposal_id", proposal_id)
+        ("initiator", members[2])));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_summary(app_pool, proposal_id)["state"].as_int64(), STATE_CLOSED);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(revoke_votes, golos_worker_tester)
+try
+{
+    const name &delegate = delegates[0];
+    add_proposal(0, members[0], members[1], members[2]);
+
+    ASSERT_SUCCESS(worker->push_action(members[1], N(acceptwork), mvo()
+        ("proposal_id", 0)
+        ("comment_id", 1000)
+        ("comment", mvo()("text", ""))));
+    ASSERT_SUCCESS(worker->push_action(delegate, N(reviewwork), mvo()
+        ("proposal_id", 0)
+        ("reviewer", delegate)
+        ("status", 0)
+        ("comment_id", 1001)
+        ("comment", mvo()("text", ""))));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_summary(app_pool, 0)["negative_reviews"].as_uint64(), 1);
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(addpropos), mvo()
+        ("proposal_id", 1)
+        ("author", members[3])
+        ("title", "Proposal #1")
+        ("description", "")));
+    ASSERT_SUCCESS(worker->push_action(members[4], N(addtspec), mvo()
+        ("proposal_id", 1)
+        ("tspec_app_id", 100)
+        ("author", members[4])
+        ("tspec", mvo()
+            ("text", "Technical specification")
+            ("specification_cost", "1.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "1.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))));
+    ASSERT_SUCCESS(worker->push_action(delegate, N(approvetspec), mvo()
+        ("tspec_app_id", 100)
+        ("author", delegate)
+        ("comment_id", 1002)
+        ("comment", mvo()("text", ""))));
+    BOOST_REQUIRE_EQUAL(worker->get_secondary_order<chain::index128_index>(N(proposalstsv), app_pool, 1).size(), delegates_51 + 1);
+
+    // a rejecting review cast while the work is going on
+    add_proposal(2, members[6], members[7], members[8]);
+    ASSERT_SUCCESS(worker->push_action(delegate, N(reviewwork), mvo()
+        ("proposal_id", 2)
+        ("reviewer", delegate)
+        ("status", 0)
+        ("comment_id", 1003)
+        ("comment", mvo()("text", ""))));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, 2), STATE_WORK);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_summary(app_pool, 2)["negative_reviews"].as_uint64(), 1);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(delegate, N(revokevotes), mvo()
+        ("voter", delegate)
+        ("max_count", 10)), error("missing authority of app.worker"));
+
+    // the approval of the chosen application stays, the open approval and review are revoked
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(revokevotes), mvo()
+        ("voter", delegate)
+        ("max_count", 10)));
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(revocations), app_pool), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(proposalstsv), app_pool), 2 * delegates_51);
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(proposalsrv), app_pool), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_summary(app_pool, 0)["negative_reviews"].as_uint64(), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_summary(app_pool, 2)["negative_reviews"].as_uint64(), 0);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(revokevotes), mvo()
+        ("voter", members[5])
+        ("max_count", 10)), wasm_assert_msg("nothing to revoke"));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(vote_tree, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+
+    // a light client recomputes the root from the votes (or a vote from its sibling nodes)
+    struct tally_node_t {
+        fc::sha256 hash;
+        uint32_t positive;
+        uint32_t negative;
+    };
+    auto leaf = [](const name &voter, bool positive) {
+        char buffer[sizeof(uint64_t) + 1];
+        memcpy(buffer, &voter.value, sizeof(uint64_t));
+        buffer[sizeof(uint64_t)] = positive;
+        return tally_node_t{fc::sha256::hash(buffer, sizeof(buffer)), positive, !positive};
+    };
+    auto inner = [](const tally_node_t &left, const tally_node_t &right) {
+        tally_node_t node{fc::sha256(), left.positive + right.positive, left.negative + right.negative};
+        if (node.positive + node.negative > 0) {
+            char buffer[80];
+            memcpy(buffer, left.hash.data(), 32);
+            memcpy(buffer + 32, &left.positive, 4);
+            memcpy(buffer + 36, &left.negative, 4);
+            memcpy(buffer + 40, right.hash.data(), 32);
+            memcpy(buffer + 72, &right.positive, 4);
+            memcpy(buffer + 76, &right.negative, 4);
+            node.hash = fc::sha256::hash(buffer, sizeof(buffer));
+        }
+        return node;
+    };
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "")));
+
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(votepropos), mvo()
+            ("proposal_id", proposal_id)
+            ("voter", members[i])
+            ("positive", i % 2)));
+    }
+
+    auto root = worker->get_vote_root(app_pool, proposal_id);
+    BOOST_REQUIRE_EQUAL(root["count"].as_uint64(), 3);
+    BOOST_REQUIRE_EQUAL(root["depth"].as_uint64(), 2);
+    BOOST_REQUIRE_EQUAL(root["positive"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(root["negative"].as_uint64(), 2);
+    tally_node_t expected = inner(
+        inner(leaf(members[0], false), leaf(members[1], true)),
+        inner(leaf(members[2], false), tally_node_t{fc::sha256(), 0, 0}));
+    BOOST_REQUIRE_EQUAL(root["hash"].as_string(), expected.hash.str());
+    BOOST_REQUIRE_EQUAL(worker->get_vote_nodes_count(app_pool), 3 + 2 + 1);
+
+    // a revote changes the leaf in place
+    ASSERT_SUCCESS(worker->push_action(members[2], N(votepropos), mvo()
+        ("proposal_id", proposal_id)
+        ("voter", members[2])
+        ("positive", 1)));
+    root = worker->get_vote_root(app_pool, proposal_id);
+    expected = inner(
+        inner(leaf(members[0], false), leaf(members[1], true)),
+        inner(leaf(members[2], true), tally_node_t{fc::sha256(), 0, 0}));
+    BOOST_REQUIRE_EQUAL(root["hash"].as_string(), expected.hash.str());
+    BOOST_REQUIRE_EQUAL(root["positive"].as_uint64(), 2);
+
+    // a rebuild from the votes gives the same root
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(syncsummary), mvo()
+        ("proposal_id", proposal_id)));
+    BOOST_REQUIRE_EQUAL(worker->get_vote_root(app_pool, proposal_id)["hash"].as_string(), expected.hash.str());
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", proposal_id)));
+    BOOST_REQUIRE_EQUAL(worker->get_vote_nodes_count(app_pool), 0);
+    BOOST_REQUIRE_EQUAL(worker->get_vote_roots_count(app_pool), 0);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(weighted_votes, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "")));
+
+    // a vote cast before the weighting is weighed by syncsummary
+    ASSERT_SUCCESS(worker->push_action(members[0], N(votepropos), mvo()
+        ("proposal_id", proposal_id)
+        ("voter", members[0])
+        ("positive", 1)));
+
+    // the snapshots aren't looked at before the weighting is turned on
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(refreshvotes), mvo()
+        ("voter", members[0])
+        ("max_count", 10)), wasm_assert_msg("nothing to refresh"));
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(weighvotes), mvo()), error("missing authority of app.worker"));
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(weighvotes), mvo()));
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(weighvotes), mvo()), wasm_assert_msg("the votes are already weighted"));
+
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setbalance), mvo()
+            ("account", members[i])
+            ("quantity", asset(100 * (i + 1), app_token_supply.get_symbol()))));
+    }
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(setbalance), mvo()
+        ("account", members[0])
+        ("quantity", "1.000 GLS")), wasm_assert_msg("invalid token symbol"));
+
+    BOOST_REQUIRE(worker->get_weighted_tally(app_pool, proposal_id).is_null());
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(syncsummary), mvo()
+        ("proposal_id", proposal_id)));
+
+    for (size_t i = 1; i < 3; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(votepropos), mvo()
+            ("proposal_id", proposal_id)
+            ("voter", members[i])
+            ("positive", i % 2)));
+    }
+
+    auto tally = worker->get_weighted_tally(app_pool, proposal_id);
+    BOOST_REQUIRE_EQUAL(tally["count"].as_uint64(), 3);
+    BOOST_REQUIRE_EQUAL(tally["positive"].as_uint64(), 100 + 200);
+    BOOST_REQUIRE_EQUAL(tally["negative"].as_uint64(), 300);
+
+    // the vote keeps its snapshot until it is refreshed
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setbalance), mvo()
+        ("account", members[2])
+        ("quantity", asset(50, app_token_supply.get_symbol()))));
+    BOOST_REQUIRE_EQUAL(worker->get_weighted_tally(app_pool, proposal_id)["negative"].as_uint64(), 300);
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(refreshvotes), mvo()
+        ("voter", members[2])
+        ("max_count", 10)));
+    BOOST_REQUIRE_EQUAL(worker->get_weighted_tally(app_pool, proposal_id)["negative"].as_uint64(), 50);
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[3], N(refreshvotes), mvo()
+        ("voter", members[2])
+        ("max_count", 10)), wasm_assert_msg("nothing to refresh"));
+
+    // a revote moves the weight with the current balance
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setbalance), mvo()
+        ("account", members[1])
+        ("quantity", asset(20, app_token_supply.get_symbol()))));
+    ASSERT_SUCCESS(worker->push_action(members[1], N(votepropos), mvo()
+        ("proposal_id", proposal_id)
+        ("voter", members[1])
+        ("positive", 0)));
+    tally = worker->get_weighted_tally(app_pool, proposal_id);
+    BOOST_REQUIRE_EQUAL(tally["positive"].as_uint64(), 100);
+    BOOST_REQUIRE_EQUAL(tally["negative"].as_uint64(), 20 + 50);
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", proposal_id)));
+    BOOST_REQUIRE(worker->get_weighted_tally(app_pool, proposal_id).is_null());
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(voteweights), app_pool), 0);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(proxy_votes, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    const name &proxy = members[0];
+
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(weighvotes), mvo()));
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setbalance), mvo()
+            ("account", members[i])
+            ("quantity", asset(100 * (i + 1), app_token_supply.get_symbol()))));
+    }
+
+    for (size_t i = 1; i < 3; i++) {
+        ASSERT_SUCCESS(worker->push_action(members[i], N(setproxy), mvo()
+            ("account", members[i])
+            ("proxy", proxy)));
+    }
+    BOOST_REQUIRE_EQUAL(worker->get_proxy(app_pool, proxy)["delegators"].as_uint64(), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_proxy(app_pool, proxy)["weight"].as_uint64(), 200 + 300);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[1], N(setproxy), mvo()
+        ("account", members[1])
+        ("proxy", proxy)), wasm_assert_msg("the proxy is already set"));
+    BOOST_REQUIRE_EQUAL(worker->push_action(proxy, N(setproxy), mvo()
+        ("account", proxy)
+        ("proxy", members[3])), wasm_assert_msg("a proxy can't delegate its votes"));
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[3], N(setproxy), mvo()
+        ("account", members[3])
+        ("proxy", members[1])), wasm_assert_msg("the proxy delegates its votes"));
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", members[0])
+        ("title", "Proposal #1")
+        ("description", "")));
+    ASSERT_SUCCESS(worker->push_action(proxy, N(votepropos), mvo()
+        ("proposal_id", proposal_id)
+        ("voter", proxy)
+        ("positive", 1)));
+    ASSERT_SUCCESS(worker->push_action(members[3], N(votepropos), mvo()
+        ("proposal_id", proposal_id)
+        ("voter", members[3])
+        ("positive", 0)));
+
+    auto tally = worker->get_weighted_tally(app_pool, proposal_id);
+    BOOST_REQUIRE_EQUAL(tally["positive"].as_uint64(), 100 + 200 + 300);
+    BOOST_REQUIRE_EQUAL(tally["negative"].as_uint64(), 400);
+
+    // a delegator leaving the proxy and a delegated balance change are counted when the proxy votes are refreshed
+    ASSERT_SUCCESS(worker->push_action(members[2], N(setproxy), mvo()
+        ("account", members[2])
+        ("proxy", name())));
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setbalance), mvo()
+        ("account", members[1])
+        ("quantity", asset(250, app_token_supply.get_symbol()))));
+    BOOST_REQUIRE_EQUAL(worker->get_proxy(app_pool, proxy)["delegators"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proxy(app_pool, proxy)["weight"].as_uint64(), 250);
+    BOOST_REQUIRE_EQUAL(worker->get_weighted_tally(app_pool, proposal_id)["positive"].as_uint64(), 600);
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(refreshvotes), mvo()
+        ("voter", proxy)
+        ("max_count", 10)));
+    BOOST_REQUIRE_EQUAL(worker->get_weighted_tally(app_pool, proposal_id)["positive"].as_uint64(), 100 + 250);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(ram_quotas, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    const name &author = members[0];
+    const name &commenter = members[1];
+
+    ASSERT_SUCCESS(worker->push_action(author, N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", author)
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+    const uint64_t proposal_bytes = worker->get_account_usage(app_pool, author)["bytes"].as_uint64();
+    BOOST_REQUIRE_EQUAL(worker->get_account_usage(app_pool, author)["rows"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_usage(app_pool, proposal_id)["bytes"].as_uint64(), proposal_bytes);
+
+    ASSERT_SUCCESS(worker->push_action(commenter, N(addcomment), mvo()
+        ("proposal_id", proposal_id)
+        ("comment_id", 1)
+        ("author", commenter)
+        ("data", mvo()("text", "Awesome!"))));
+    const uint64_t comment_bytes = worker->get_account_usage(app_pool, commenter)["bytes"].as_uint64();
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_usage(app_pool, proposal_id)["rows"].as_uint64(), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_usage(app_pool, proposal_id)["bytes"].as_uint64(), proposal_bytes + comment_bytes);
+
+    // an edit is charged with the size change
+    ASSERT_SUCCESS(worker->push_action(commenter, N(editcomment), mvo()
+        ("comment_id", 1)
+        ("data", mvo()("text", "Awesome!!!"))));
+    BOOST_REQUIRE_EQUAL(worker->get_account_usage(app_pool, commenter)["bytes"].as_uint64(), comment_bytes + 2);
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(commenter, N(setquotas), mvo()
+        ("account_bytes", 1)
+        ("proposal_bytes", 1)), error("missing authority of app.worker"));
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setquotas), mvo()
+        ("account_bytes", comment_bytes + 100)
+        ("proposal_bytes", 0)));
+    BOOST_REQUIRE_EQUAL(worker->push_action(commenter, N(addcomment), mvo()
+        ("proposal_id", proposal_id)
+        ("comment_id", 2)
+        ("author", commenter)
+        ("data", mvo()("text", "Spam"))), wasm_assert_msg("account RAM quota exceeded"));
+
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setquotas), mvo()
+        ("account_bytes", 0)
+        ("proposal_bytes", proposal_bytes + comment_bytes + 100)));
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[2], N(addcomment), mvo()
+        ("proposal_id", proposal_id)
+        ("comment_id", 2)
+        ("author", members[2])
+        ("data", mvo()("text", "Spam"))), wasm_assert_msg("proposal RAM quota exceeded"));
+
+    // the space is given back with the rows
+    ASSERT_SUCCESS(worker->push_action(commenter, N(delcomment), mvo()("comment_id", 1)));
+    BOOST_REQUIRE(worker->get_account_usage(app_pool, commenter).is_null());
+    ASSERT_SUCCESS(worker->push_action(author, N(delpropos), mvo()("proposal_id", proposal_id)));
+    BOOST_REQUIRE(worker->get_account_usage(app_pool, author).is_null());
+    BOOST_REQUIRE(worker->get_proposal_usage(app_pool, proposal_id).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(delegate_quotas, golos_worker_tester)
+try
+{
+    add_proposal(0, members[0], members[1], members[2]);
+
+    // the approval and its comment are charged to the delegate
+    const auto usage = worker->get_account_usage(app_pool, delegates[0]);
+    BOOST_REQUIRE_EQUAL(usage["rows"].as_uint64(), 2);
+
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setquotas), mvo()
+        ("account_bytes", usage["bytes"].as_uint64())
+        ("proposal_bytes", 0)));
+    BOOST_REQUIRE_EQUAL(worker->push_action(delegates[0], N(reviewwork), mvo()
+        ("proposal_id", 0)
+        ("reviewer", delegates[0])
+        ("status", 0)
+        ("comment_id", 1000)
+        ("comment", mvo()("text", "Lorem Ipsum"))), wasm_assert_msg("account RAM quota exceeded"));
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(addpropos), mvo()
+        ("proposal_id", 1)
+        ("author", members[3])
+        ("title", "Proposal #1")
+        ("description", "")));
+    ASSERT_SUCCESS(worker->push_action(members[4], N(addtspec), mvo()
+        ("proposal_id", 1)
+        ("tspec_app_id", 100)
+        ("author", members[4])
+        ("tspec", mvo()
+            ("text", "Technical specification")
+            ("specification_cost", "5.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "5.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))));
+    BOOST_REQUIRE_EQUAL(worker->push_action(delegates[0], N(approvetspec), mvo()
+        ("tspec_app_id", 100)
+        ("author", delegates[0])
+        ("comment_id", 1000)
+        ("comment", mvo()("text", "Lorem Ipsum"))), wasm_assert_msg("account RAM quota exceeded"));
+
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(setquotas), mvo()
+        ("account_bytes", 0)
+        ("proposal_bytes", 0)));
+    ASSERT_SUCCESS(worker->push_action(delegates[0], N(reviewwork), mvo()
+        ("proposal_id", 0)
+        ("reviewer", delegates[0])
+        ("status", 0)
+        ("comment_id", 1000)
+        ("comment", mvo()("text", "Lorem Ipsum"))));
+    BOOST_REQUIRE_EQUAL(worker->get_account_usage(app_pool, delegates[0])["rows"].as_uint64(), 3);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(import, golos_worker_tester)
+try
+{
+    const string description = "Imported description";
+    const string comment_text = "Imported comment";
+    const auto created = control->head_block_time();
+
+    auto proposal = [&](uint64_t id, uint8_t state) {
+        return mvo()
+            ("id", id)
+            ("author", members[0])
+            ("type", uint8_t(golos::proposal_rules::TYPE_1))
+            ("state", state)
+            ("title", "Imported proposal")
+            ("description", "")
+            ("description_hash", fc::sha256::hash(description).str())
+            ("fund_name", worker_code_account)
+            ("deposit", "0.000 APP")
+            ("tspec_id", 0)
+            ("worker", name())
+            ("work_begining_time", created)
+            ("worker_payments_count", 0)
+            ("payment_begining_time", created)
+            ("created", created)
+            ("modified", created)
+            ("version", 1);
+    };
+    const vector<fc::variant> proposals{proposal(0, STATE_TSPEC_APP), proposal(1, STATE_CLOSED)};
+    const string tspec_text = "Imported technical specification";
+    const vector<fc::variant> tspecs{mvo()
+        ("id", 20)
+        ("foreign_id", 0)
+        ("author", members[2])
+        ("data", mvo()
+            ("text", tspec_text)
+            ("specification_cost", "5.000 APP")
+            ("specification_eta", 1)
+            ("development_cost", "5.000 APP")
+            ("development_eta", 1)
+            ("payments_count", 1)
+            ("payments_interval", 1))
+        ("created", created)
+        ("modified", created)
+        ("version", 1)};
+    auto comment = [&](uint64_t id, uint64_t foreign_id, name author, const string &text) {
+        return mvo()
+            ("id", id)
+            ("foreign_id", foreign_id)
+            ("author", author)
+            ("data", mvo()("text", ""))
+            ("text_hash", fc::sha256::hash(text).str())
+            ("text_size", text.size())
+            ("created", created)
+            ("modified", created)
+            ("version", 1);
+    };
+    const vector<fc::variant> comments{comment(10, 0, members[1], comment_text)};
+    vector<fc::variant> votes;
+    for (size_t i = 0; i < 3; i++) {
+        votes.push_back(mvo()("id", i)("voter", members[i])("foreign_id", 0)("positive", i != 1));
+    }
+    auto batch = [&](uint64_t first) {
+        return mvo()
+            ("pool", "APP")
+            ("first", first)
+            ("texts", vector<string>{description, comment_text})
+            ("proposals", proposals)
+            ("tspecs", tspecs)
+            ("comments", comments)
+            ("votes", votes)
+            // the statuses, reviews and approve comments keep only the hashes, their texts aren't sent
+            ("tspec_comments", vector<fc::variant>{comment(10, 20, delegates[0], "Imported approval")})
+            ("status_comments", vector<fc::variant>{comment(11, 1, members[0], "Imported status")})
+            ("review_comments", vector<fc::variant>{comment(12, 1, delegates[1], "Imported review")})
+            ("tspec_votes", vector<fc::variant>{mvo()("id", 0)("voter", delegates[0])("foreign_id", 20)("positive", true)})
+            ("review_votes", vector<fc::variant>{mvo()("id", 0)("voter", delegates[1])("foreign_id", 1)("positive", false)});
+    };
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(import), batch(0)), error("missing authority of app.worker"));
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(import), batch(1)), wasm_assert_msg("the batch doesn't continue the import"));
+
+    const int64_t author_ram = control->get_resource_limits_manager().get_account_ram_usage(members[0]);
+    const auto trace = push_action(worker_code_account, N(import), worker_code_account, batch(0));
+    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(app_pool), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(app_pool), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), 3);
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 3);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment_text(app_pool, 10), comment_text);
+    auto tspec = worker->get_tspec(app_pool, 20);
+    BOOST_REQUIRE_EQUAL(tspec["data"]["text"].as_string(), "");
+    BOOST_REQUIRE_EQUAL(worker->get_text(app_pool, tspec["text_hash"])["text"].as_string(), tspec_text);
+
+    BOOST_REQUIRE_EQUAL(worker->get_table_rows(N(tspecappc), "comment_t", app_pool).size(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_table_rows(N(statusc), "comment_t", app_pool).size(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_table_rows(N(reviewc), "comment_t", app_pool).size(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_table_rows(N(proposalstsv), "vote_t", app_pool).size(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_table_rows(N(proposalsrv), "vote_t", app_pool).size(), 1);
+
+    // the usage is counted for the authors, the RAM is billed to the contract
+    BOOST_REQUIRE_EQUAL(worker->get_account_usage(app_pool, members[0])["rows"].as_uint64(), 4);
+    BOOST_REQUIRE_EQUAL(worker->get_account_usage(app_pool, members[2])["rows"].as_uint64(), 2);
+    BOOST_REQUIRE_EQUAL(control->get_resource_limits_manager().get_account_ram_usage(members[0]), author_ram);
+    auto summary = worker->get_proposal_summary(app_pool, 0);
+    BOOST_REQUIRE_EQUAL(summary["comments_count"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(summary["positive_votes"].as_uint64(), 2);
+    BOOST_REQUIRE_EQUAL(summary["negative_votes"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(summary["tspec_comments_count"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_vote_root(app_pool, 0)["count"].as_uint64(), 3);
+    summary = worker->get_proposal_summary(app_pool, 1);
+    BOOST_REQUIRE_EQUAL(summary["status_comments_count"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(summary["negative_reviews"].as_uint64(), 1);
+
+    // a batch sent again skips the rows imported before
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(import), batch(0)));
+    BOOST_REQUIRE_EQUAL(worker->get_proposals_count(app_pool), 2);
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 3);
+
+    // a proposal past the applications would need a deposit, setfund can't lock it there
+    const uint64_t imported_rows = 2 + 1 + 1 + 3 + 5;
+    for (uint8_t state : {STATE_TSPEC_CREATE, STATE_WORK, STATE_PAYMENT}) {
+        BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(import), mvo()
+            ("pool", "APP")
+            ("first", imported_rows)
+            ("texts", vector<string>{})
+            ("proposals", vector<fc::variant>{proposal(2, state)})
+            ("tspecs", vector<fc::variant>{})
+            ("comments", vector<fc::variant>{})
+            ("votes", vector<fc::variant>{})
+            ("tspec_comments", vector<fc::variant>{})
+            ("status_comments", vector<fc::variant>{})
+            ("review_comments", vector<fc::variant>{})
+            ("tspec_votes", vector<fc::variant>{})
+            ("review_votes", vector<fc::variant>{})),
+            wasm_assert_msg("only the proposals waiting for the applications or closed can be imported"));
+    }
+
+    // the imported proposal goes on with the regular actions
+    ASSERT_SUCCESS(worker->push_action(members[3], N(votepropos), mvo()
+        ("proposal_id", 0)
+        ("voter", members[3])
+        ("positive", 1)));
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(votepropos), mvo()
+        ("proposal_id", 0)
+        ("voter", members[0])
+        ("positive", 1)), wasm_assert_msg("the vote already exists"));
+
+    golos::indexer::worker_index index(worker_code_account, "APP", fc::json::from_string(contracts::golos_worker_abi().data()).as<abi_def>());
+    index.apply(trace->action_traces[0]);
+    BOOST_REQUIRE(index.find_proposal(1) != nullptr);
+    BOOST_REQUIRE_EQUAL(index.find_proposal(1)->state, STATE_CLOSED);
+    auto indexed_votes = index.votes(N(proposalsv), 0);
+    BOOST_REQUIRE_EQUAL(std::distance(indexed_votes.first, indexed_votes.second), 3);
+    indexed_votes = index.votes(N(proposalstsv), 20);
+    BOOST_REQUIRE_EQUAL(std::distance(indexed_votes.first, indexed_votes.second), 1);
+    auto indexed_comments = index.comments(N(statusc), 1);
+    BOOST_REQUIRE_EQUAL(std::distance(indexed_comments.first, indexed_comments.second), 1);
+    BOOST_REQUIRE_EQUAL(index.search("imported comment", 10).size(), 1);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(row_versions, golos_worker_tester)
+try
+{
+    add_proposal(0, members[0], members[1], members[2]);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["version"].as_uint64(), 1);
+
+    const vector<name> tables{N(proposals), N(tspecs), N(tspecappc), N(statusc)};
+    auto for_each_row = [&](const name &table, auto &&visitor) {
+        auto &db = control->mutable_db();
+        const auto *t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, table));
+        BOOST_REQUIRE(t_id != nullptr);
+        const auto &idx = db.get_index<key_value_index, by_scope_primary>();
+        for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id, 0)); itr != idx.end() && itr->t_id == t_id->id; itr++) {
+            visitor(db, *itr);
+        }
+    };
+
+    // the rows stored before the version was added end right before it
+    size_t rows_count = 0;
+    for (const name &table : tables) {
+        for_each_row(table, [&](chainbase::database &db, const key_value_object &row) {
+            db.modify(row, [](key_value_object &obj) {
+                obj.value.resize(obj.value.size() - 1);
+            });
+            rows_count++;
+        });
+    }
+    BOOST_REQUIRE(!worker->get_table_rows(N(proposals), "proposal_t", app_pool).front().get_object().contains("version"));
+    for_each_row(N(tspecs), [&](chainbase::database &, const key_value_object &row) {
+        BOOST_REQUIRE_EQUAL(row.payer, members[1]);
+    });
+
+    // the legacy rows are read as the version 0
+    golos::snapshot::table_exporter exporter(fc::json::from_string(contracts::golos_worker_abi().data()).as<abi_def>());
+    auto proposals = exporter.export_rows(N(proposals), golos::snapshot::read_rows(control->db(), worker_code_account, app_pool, N(proposals)));
+    const string path = "golos.worker.snapshot.versions.col";
+    proposals.write(path);
+    golos::snapshot::table_reader proposals_reader(path);
+    BOOST_REQUIRE_EQUAL(proposals_reader.rows(), 1);
+    BOOST_REQUIRE_EQUAL(proposals_reader.values<uint8_t>("version")[0], 0);
+
+    ASSERT_SUCCESS(worker->push_action(members[3], N(addcomment), mvo()
+        ("proposal_id", 0)
+        ("comment_id", 1000)
+        ("author", members[3])
+        ("data", mvo()("text", "Awesome!"))));
+    rows_count++;
+
+    // the rows grow, their authors can't be billed by another account
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[3], N(migrate), mvo()("max_rows", 4)), error("missing authority of app.worker"));
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(migrate), mvo()("max_rows", 0)), wasm_assert_msg("max_rows must be positive"));
+    const uint16_t max_rows = 4;
+    size_t calls = 0;
+    while (worker->push_action(worker_code_account, N(migrate), mvo()("max_rows", max_rows)) == success()) {
+        produce_blocks(1);
+        calls++;
+    }
+    BOOST_REQUIRE_EQUAL(calls, (rows_count + max_rows - 1) / max_rows);
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(migrate), mvo()("max_rows", max_rows)), wasm_assert_msg("nothing to migrate"));
+
+    for (const name &table : tables) {
+        const char *type = table == N(proposals) ? "proposal_t" : table == N(tspecs) ? "tspec_app_t" : "comment_t";
+        for (const auto &row : worker->get_table_rows(table, type, app_pool)) {
+            BOOST_REQUIRE_EQUAL(row["version"].as_uint64(), 1);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["title"].as_string(), "Proposal #0");
+
+    // the legacy rows have been billed to their authors, migrate has grown them at the cost of the contract
+    for (const name &table : tables) {
+        for_each_row(table, [&](chainbase::database &, const key_value_object &row) {
+            BOOST_REQUIRE_EQUAL(row.payer, worker_code_account);
+        });
+    }
+    for_each_row(N(proposalsc), [&](chainbase::database &, const key_value_object &row) {
+        BOOST_REQUIRE_EQUAL(row.payer, members[3]);
+    });
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(legacy_text_rows, golos_worker_tester)
+try
+{
+    const string description = "Legacy description";
+    const string comment_text = "Legacy comment";
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+        ("proposal_id", 0)
+        ("author", members[0])
+        ("title", "Proposal #0")
+        ("description", "")));
+    ASSERT_SUCCESS(worker->push_action(members[1], N(addcomment), mvo()
+        ("proposal_id", 0)
+        ("comment_id", 0)
+        ("author", members[1])
+        ("data", mvo()("text", ""))));
+
+    // the rows stored before the text store keep the text inline and end right after modified
+    auto set_row = [&](name table, uint64_t id, const vector<char> &value) {
+        auto &db = control->mutable_db();
+        const auto *t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, table));
+        BOOST_REQUIRE(t_id != nullptr);
+        db.modify(db.get<key_value_object, by_scope_primary>(boost::make_tuple(t_id->id, id)), [&](key_value_object &obj) {
+            obj.value.assign(value.data(), value.size());
+        });
+    };
+    mutable_variant_object proposal(worker->get_proposal(app_pool, 0));
+    proposal.erase("description_hash");
+    proposal.erase("version");
+    proposal("description", description);
+    set_row(N(proposals), 0, worker->pack_row("proposal_t", proposal));
+    mutable_variant_object comment(worker->get_proposal_comment(app_pool, 0));
+    comment.erase("text_hash");
+    comment.erase("text_size");
+    comment.erase("version");
+    comment("data", mvo()("text", comment_text));
+    set_row(N(proposalsc), 0, worker->pack_row("comment_t", comment));
+
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["description"].as_string(), description);
+    BOOST_REQUIRE(!worker->get_proposal_comment(app_pool, 0).get_object().contains("text_hash"));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment(app_pool, 0)["data"]["text"].as_string(), comment_text);
+
+    golos::snapshot::table_exporter exporter(fc::json::from_string(contracts::golos_worker_abi().data()).as<abi_def>());
+    auto proposals = exporter.export_rows(N(proposals), golos::snapshot::read_rows(control->db(), worker_code_account, app_pool, N(proposals)));
+    BOOST_REQUIRE_EQUAL(proposals.rows(), 1);
+
+    // migrate moves the texts of the version 0 rows to the text store
+    ASSERT_SUCCESS(worker->push_action(worker_code_account, N(migrate), mvo()("max_rows", 10)));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["version"].as_uint64(), 1);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["description"].as_string(), "");
+    BOOST_REQUIRE_EQUAL(worker->get_text(app_pool, worker->get_proposal(app_pool, 0)["description_hash"])["text"].as_string(), description);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment(app_pool, 0)["data"]["text"].as_string(), "");
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment(app_pool, 0)["text_size"].as_uint64(), comment_text.size());
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment_text(app_pool, 0), comment_text);
+
+    // the edits replace the moved texts
+    ASSERT_SUCCESS(worker->push_action(members[1], N(editcomment), mvo()
+        ("proposal_id", 0)
+        ("comment_id", 0)
+        ("data", mvo()("text", "Edited comment"))));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment(app_pool, 0)["data"]["text"].as_string(), "");
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_comment_text(app_pool, 0), "Edited comment");
+    ASSERT_SUCCESS(worker->push_action(members[0], N(editpropos), mvo()
+        ("proposal_id", 0)
+        ("title", fc::variant())
+        ("description", "Edited description")));
+    BOOST_REQUIRE_EQUAL(worker->get_proposal(app_pool, 0)["description"].as_string(), "");
+    BOOST_REQUIRE_EQUAL(worker->get_text(app_pool, worker->get_proposal(app_pool, 0)["description_hash"])["text"].as_string(), "Edited description");
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", 0)));
+    BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 0);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(seeded_totals, golos_worker_tester)
+try
+{
+    ASSERT_SUCCESS(token->transfer(members[0], worker_code_account, asset::from_string("20.000 APP"), members[0].to_string()));
+    for (uint64_t proposal_id = 0; proposal_id < 2; proposal_id++) {
+        ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+            ("proposal_id", proposal_id)
+            ("author", members[0])
+            ("title", "Proposal")
+            ("description", "Description")));
+        ASSERT_SUCCESS(worker->push_action(members[0], N(setfund), mvo()
+            ("proposal_id", proposal_id)
+            ("fund_name", members[0])
+            ("quantity", "10.000 APP")));
+    }
+
+    // the deposits were locked before the totals and the journal were kept
+    for (const name &table : {N(totals), N(journal)}) {
+        auto &db = control->mutable_db();
+        const auto *t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(worker_code_account, app_pool, table));
+        BOOST_REQUIRE(t_id != nullptr);
+        const auto &idx = db.get_index<key_value_index, by_scope_primary>();
+        for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id, 0)); itr != idx.end() && itr->t_id == t_id->id; itr = idx.lower_bound(boost::make_tuple(t_id->id, 0))) {
+            db.remove(*itr);
+            db.modify(*t_id, [](table_id_object &t) {
+                t.count--;
+            });
+        }
+    }
+
+    // no fund movement is accepted until the totals are counted
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", 0)),
+                        wasm_assert_msg("the totals have to be counted by synctotals"));
+
+    BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(synctotals), mvo()("max_rows", 1)), error("missing authority of app.worker"));
+    BOOST_REQUIRE_EQUAL(worker->push_action(worker_code_account, N(synctotals), mvo()("max_rows", 0)), wasm_assert_msg("max_rows must be positive"));
+
+    // the sync goes through the two funds and the two proposals a row per call
+    size_t calls = 0;
+    while (worker->get_totals(app_pool).is_null()) {
+        ASSERT_SUCCESS(worker->push_action(worker_code_account, N(synctotals), mvo()("max_rows", 1)));
+        produce_blocks(1);
+        calls++;
+        if (calls == 1) {
+            BOOST_REQUIRE_EQUAL(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", 0)),
+                                wasm_assert_msg("the totals have to be counted by synctotals"));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(calls, 4);
+    BOOST_REQUIRE_EQUAL(worker->get_table_size(N(totalssync), app_pool), 0);
+    auto totals = worker->get_totals(app_pool);
+    BOOST_REQUIRE_EQUAL(totals["deposited"].as<asset>(), asset::from_string("20.000 APP"));
+    const asset contract_balance = token->get_account(worker_code_account, "3,APP")["balance"].as<asset>();
+    BOOST_REQUIRE_EQUAL(totals["funded"].as<asset>() - totals["paid"].as<asset>(), contract_balance);
+
+    ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", 0)));
+    BOOST_REQUIRE_EQUAL(worker->get_totals(app_pool)["deposited"].as<asset>(), asset::from_string("10.000 APP"));
+    ASSERT_SUCCESS(worker->push_action(members[0], N(delpropos), mvo()("proposal_id", 1)));
+    BOOST_REQUIRE_EQUAL(worker->get_totals(app_pool)["deposited"].as<asset>(), asset::from_string("0.000 APP"));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(delete_cost, golos_worker_tester)
+try
+{
+    const size_t votes_count = members.size() + delegates.size();
+
+    // deletes a proposal with the comments and a vote of every account, returns the elapsed time of delpropos
+    auto delete_proposal = [&](uint64_t proposal_id, size_t comments_count) {
+        ASSERT_SUCCESS(worker->push_action(members[0], N(addpropos), mvo()
+            ("proposal_id", proposal_id)
+            ("author", members[0])
+            ("title", "Proposal #1")
+            ("description", "")));
+        for (size_t i = 0; i < comments_count; i++) {
+            const name &author = members[i % members.size()];
+            ASSERT_SUCCESS(worker->push_action(author, N(addcomment), mvo()
+                ("proposal_id", proposal_id)
+                ("comment_id", proposal_id * 1000 + i)
+                ("author", author)
+                ("data", mvo()("text", "Comment #" + std::to_string(i)))));
+        }
+        for (const vector<name> *voters : {&members, &delegates}) {
+            for (const name &voter : *voters) {
+                ASSERT_SUCCESS(worker->push_action(voter, N(votepropos), mvo()
+                    ("proposal_id", proposal_id)
+                    ("voter", voter)
+                    ("positive", 1)));
+            }
+        }
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), votes_count);
+        produce_blocks(1);
+
+        // the comments and the votes are erased through their foreign ranges
+        auto trace = push_action(worker_code_account, N(delpropos), members[0], mvo()
+            ("pool", "APP")
+            ("proposal_id", proposal_id));
+        const int64_t elapsed = trace->action_traces.front().elapsed.count();
+        BOOST_TEST_MESSAGE("delpropos with " << comments_count << " comments and " << votes_count << " votes: "
+            << elapsed << " us, " << trace->receipt->cpu_usage_us << " us billed");
+        BOOST_REQUIRE_EQUAL(worker->get_proposals_count(app_pool), 0);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_comments_count(app_pool), 0);
+        BOOST_REQUIRE_EQUAL(worker->get_proposal_votes_count(app_pool), 0);
+        BOOST_REQUIRE_EQUAL(worker->get_texts_count(app_pool), 0);
+        produce_blocks(1);
+        return elapsed;
+    };
+
+    // the tester doesn't count the db intrinsics, the cost of a comment row is the difference of the elapsed times
+    const size_t few = 20, many = 80;
+    const int64_t few_elapsed = delete_proposal(0, few);
+    const int64_t many_elapsed = delete_proposal(1, many);
+    BOOST_TEST_MESSAGE("delpropos: " << double(many_elapsed - few_elapsed) / (many - few) << " us per comment");
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(delete_refund, golos_worker_tester)
+try
+{
+    const uint64_t proposal_id = 0;
+    const name &sponsor = members[0];
+
+    ASSERT_SUCCESS(worker->push_action(sponsor, N(addpropos), mvo()
+        ("proposal_id", proposal_id)
+        ("author", sponsor)
+        ("title", "Proposal #1")
+        ("description", "Description #1")));
+    ASSERT_SUCCESS(token->transfer(sponsor, worker_code_account, asset::from_string("10.000 APP"), sponsor.to_string()));
+    ASSERT_SUCCESS(worker->push_action(sponsor, N(setfund), mvo()
+        ("proposal_id", proposal_id)
+        ("fund_name", sponsor)
+        ("quantity", "10.000 APP")));
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, sponsor)["quantity"], "0.000 APP");
+    BOOST_REQUIRE_EQUAL(worker->get_totals(app_pool)["deposited"].as<asset>(), asset::from_string("10.000 APP"));
+
+    // the deposit of a deleted proposal goes back to the fund it has been locked from
+    ASSERT_SUCCESS(worker->push_action(sponsor, N(delpropos), mvo()
+        ("proposal_id", proposal_id)));
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, sponsor)["quantity"], "10.000 APP");
+    BOOST_REQUIRE_EQUAL(worker->get_totals(app_pool)["deposited"].as<asset>(), asset::from_string("0.000 APP"));
+    const auto journal = worker->get_table_rows(N(journal), "movement_t", app_pool);
+    BOOST_REQUIRE_EQUAL(journal.back()["kind"].as_uint64(), 3 /* MOVEMENT_UNLOCK */);
+    BOOST_REQUIRE_EQUAL(journal.back()["quantity"].as<asset>(), asset::from_string("10.000 APP"));
+}
+FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(cancel_work_by_worker, golos_worker_tester)
 try
 {
@@ -970,19 +2701,19 @@ try
     add_proposal(proposal_id, proposal_author, tspec_author, worker_account);
 
     // the application fund quantity should be `propsal_deposit` less if proposal is in `STATE_TSPEC_CREATE`, `STATE_WORK`
-    BOOST_REQUIRE_EQUAL(worker->get_fund(worker_code_account, worker_code_account)["quantity"], (app_fund_supply - proposal_deposit).to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], (app_fund_supply - proposal_deposit).to_string());
 
     ASSERT_SUCCESS(worker->push_action(worker_account, N(cancelwork), mvo()
         ("proposal_id", proposal_id)
         ("initiator", worker_account)));
 
     BOOST_REQUIRE_EQUAL(worker->push_action(worker_account, N(withdraw), mvo()
-        ("proposal_id", proposal_id)), wasm_assert_msg("invalid state for withdraw"));
+        ("proposal_id", proposal_id)), wasm_assert_code(golos::proposal_rules::invalid_state_code(golos::proposal_rules::ACTION_WITHDRAW)));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_CLOSED);
 
     // if proposal is closed deposit should be refunded to the application fund
-    BOOST_REQUIRE_EQUAL(worker->get_fund(worker_code_account, worker_code_account)["quantity"], app_fund_supply.to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], app_fund_supply.to_string());
 
     auto worker_balance = token->get_account(worker_account, initial_user_supply.get_symbol().to_string());
     REQUIRE_MATCHING_OBJECT(worker_balance, mvo()("balance", initial_user_supply));
@@ -1003,18 +2734,18 @@ try
     add_proposal(proposal_id, proposal_author, tspec_author, worker_account);
 
     // the application fund quantity should be `propsal_deposit` less if proposal is in `STATE_TSPEC_CREATE`, `STATE_WORK`
-    BOOST_REQUIRE_EQUAL(worker->get_fund(worker_code_account, worker_code_account)["quantity"], (app_fund_supply - proposal_deposit).to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], (app_fund_supply - proposal_deposit).to_string());
 
     ASSERT_SUCCESS(worker->push_action(tspec_author, N(cancelwork), mvo()
         ("proposal_id", proposal_id)
         ("initiator", tspec_author)));
 
     BOOST_REQUIRE_EQUAL(worker->push_action(worker_account, N(withdraw), mvo()
-        ("proposal_id", proposal_id)), wasm_assert_msg("invalid state for withdraw"));
+        ("proposal_id", proposal_id)), wasm_assert_code(golos::proposal_rules::invalid_state_code(golos::proposal_rules::ACTION_WITHDRAW)));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_CLOSED);
     // if proposal is closed deposit should be refunded to the application fund
-    BOOST_REQUIRE_EQUAL(worker->get_fund(worker_code_account, worker_code_account)["quantity"], app_fund_supply.to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], app_fund_supply.to_string());
 
     auto worker_balance = token->get_account(worker_account, initial_user_supply.get_symbol().to_string());
     REQUIRE_MATCHING_OBJECT(worker_balance, mvo()("balance", initial_user_supply));
@@ -1036,7 +2767,7 @@ try
     add_proposal(proposal_id, proposal_author, tspec_author, worker_account);
 
     // the application fund quantity should be `propsal_deposit` less if proposal is in `STATE_TSPEC_CREATE`, `STATE_WORK`
-    BOOST_REQUIRE_EQUAL(worker->get_fund(worker_code_account, worker_code_account)["quantity"], (app_fund_supply - proposal_deposit).to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], (app_fund_supply - proposal_deposit).to_string());
 
     for (size_t i = 0; i < delegates.size() * 3 / 4 + 1; i++) {
         const name &delegate = delegates[i];
@@ -1049,11 +2780,11 @@ try
     }
 
     BOOST_REQUIRE_EQUAL(worker->push_action(worker_account, N(withdraw), mvo()
-        ("proposal_id", proposal_id)), wasm_assert_msg("invalid state for withdraw"));
+        ("proposal_id", proposal_id)), wasm_assert_code(golos::proposal_rules::invalid_state_code(golos::proposal_rules::ACTION_WITHDRAW)));
 
-    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(worker_code_account, proposal_id), STATE_CLOSED);
+    BOOST_REQUIRE_EQUAL(worker->get_proposal_state(app_pool, proposal_id), STATE_CLOSED);
     // if proposal is closed deposit should be refunded to the application fund
-    BOOST_REQUIRE_EQUAL(worker->get_fund(worker_code_account, worker_code_account)["quantity"], app_fund_supply.to_string());
+    BOOST_REQUIRE_EQUAL(worker->get_fund(app_pool, worker_code_account)["quantity"], app_fund_supply.to_string());
 
     auto worker_balance = token->get_account(worker_account, initial_user_supply.get_symbol().to_string());
     REQUIRE_MATCHING_OBJECT(worker_balance, mvo()("balance", initial_user_supply));